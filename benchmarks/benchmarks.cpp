@@ -0,0 +1,587 @@
+#include <chrono>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "audio_simulator.h"
+#include "audio_simulator_bandlimited.h"
+#include "driver.h"
+#include "filesystem.h"
+#include "sounds.h"
+#include "txtwind.h"
+#include "user_interface.h"
+#include "world_serializer.h"
+#include "gamevars.h"
+
+/*
+  Micro-benchmarks for engine hot paths.
+
+  Every input is synthetic and generated from fixed seeds, so results are
+  comparable between builds and releases. Each benchmark is calibrated to
+  run for about the target time, repeated, and reported on stdout as one
+  line of whitespace-separated fields:
+
+    <name> <iterations> <ns per iteration, best run> <checksum>
+
+  The checksum is taken from a single iteration right after setup; it only
+  changes when the benchmarked code computes something different.
+*/
+
+using namespace ZZT;
+
+#define BENCH_SEED 20240101
+#define BENCH_STAT_COUNT 150
+#define BENCH_PROGRAM_LINES 1000
+#define BENCH_HELP_LINES 900
+#define BENCH_AUDIO_FREQUENCY 48000
+
+class BenchmarkDriver: public Driver {
+    uint16_t hsecs;
+
+public:
+    uint8_t screen[80 * 25 * 2];
+
+    BenchmarkDriver() {
+        hsecs = 0;
+        memset(screen, 0, sizeof(screen));
+    }
+
+    void update_input(void) override { advance_input(); }
+    uint16_t get_hsecs(void) override { return hsecs++; }
+    void delay(int ms) override { }
+    void idle(IdleMode mode) override { }
+    void sound_stop(void) override { }
+
+    void draw_char(int16_t x, int16_t y, uint8_t col, uint8_t chr) override {
+        int offset = (y * 80 + x) << 1;
+        screen[offset] = chr;
+        screen[offset + 1] = col;
+    }
+
+    void read_char(int16_t x, int16_t y, uint8_t &col, uint8_t &chr) override {
+        int offset = (y * 80 + x) << 1;
+        chr = screen[offset];
+        col = screen[offset + 1];
+    }
+};
+
+// Serves a single file from memory.
+class BenchmarkFilesystem: public FilesystemDriver {
+public:
+    const uint8_t *data;
+    size_t len;
+
+    BenchmarkFilesystem(): FilesystemDriver(true) {
+        data = nullptr;
+        len = 0;
+    }
+
+    IOStream *open_file(const char *filename, bool write) override {
+        if (write || data == nullptr) {
+            return new ErroredIOStream();
+        }
+        return new MemoryIOStream(data, len);
+    }
+
+    bool list_files(std::function<bool(FileEntry&)> callback) override {
+        return false;
+    }
+};
+
+// Growable text buffer for building programs and files.
+struct BenchmarkText {
+    char *data;
+    size_t len, size;
+
+    BenchmarkText() {
+        size = 4096;
+        len = 0;
+        data = (char*) malloc(size);
+    }
+
+    ~BenchmarkText() {
+        free(data);
+    }
+
+    void append(const char *fmt, ...) __attribute__((format(printf, 2, 3))) {
+        va_list args;
+        while (true) {
+            va_start(args, fmt);
+            int written = vsnprintf(data + len, size - len, fmt, args);
+            va_end(args);
+            if (written >= 0 && (size_t) written < (size - len)) {
+                len += written;
+                return;
+            }
+            size *= 2;
+            data = (char*) realloc(data, size);
+        }
+    }
+};
+
+struct BenchmarkFixture {
+    Game *game;
+    BenchmarkDriver driver;
+    BenchmarkFilesystem filesystem;
+
+    Stat program; // large program, not on the board
+    int16_t object_id; // object running a command loop
+    Board *boards[2]; // ZZT and Super ZZT sized, filled
+    Board *scratch_boards[2];
+    uint8_t *board_data[2];
+    size_t board_len[2];
+
+    SoundQueue audio_queue;
+    AudioSimulator<int16_t> *simulators[2];
+    int16_t audio_buffer[BENCH_AUDIO_FREQUENCY / 100];
+    uint8_t music[255];
+    int music_len;
+
+    BenchmarkText help;
+};
+
+static const char *bench_music = "t+c-gec-g+c-g8e.d.c.d.e.qx-b+ct-g+c-gec-g+c-g8e.d.c.d.e.qx"
+    "s1234567890h-c+cqx+ctcccs-g+cte-cs-g+c-gt+ccq-c+ec-c+eiccgs.g#f.ff#fg#g.aa#bw+c";
+
+static Serializer *bench_serializers[2] = {
+    new SerializerFormatZZT(WorldFormatZZT),
+    new SerializerFormatZZT(WorldFormatSuperZZT)
+};
+
+// Element IDs are those of ZZT.
+static void fill_tiles(Board &board, Random &random) {
+    // runs of common tiles, for realistic RLE run lengths
+    static const uint8_t elements[] = {
+        EEmpty, EEmpty, EEmpty, ENormal, ESolid, EBreakable, EForest, EWater, EGem, EFake, ELine
+    };
+
+    int16_t ix = 1, iy = 1;
+    while (iy <= board.height()) {
+        Tile tile = {
+            .element = elements[random.Next(sizeof(elements))],
+            .color = (uint8_t) (random.Next(2) == 0 ? 0x0E : (random.Next(0x7F) + 1))
+        };
+        int16_t run = 1 + random.Next(12);
+        for (; run > 0 && iy <= board.height(); run--) {
+            board.tiles.set(ix, iy, tile);
+            if (++ix > board.width()) {
+                ix = 1;
+                iy++;
+            }
+        }
+    }
+}
+
+static void fill_board(Board &board, Random &random, bool szzt) {
+    fill_tiles(board, random);
+
+    StrCopy(board.name, szzt ? "Benchmark board (Super ZZT)" : "Benchmark board");
+    board.stats.count = BENCH_STAT_COUNT - 1;
+    if (board.stats.count > board.stats.stat_size()) {
+        board.stats.count = board.stats.stat_size();
+    }
+    for (int16_t i = 0; i <= board.stats.count; i++) {
+        Stat &stat = board.stats[i];
+        stat = Stat();
+        stat.x = 1 + ((i * 7) % board.width());
+        stat.y = 1 + ((i * 7) / board.width());
+        stat.cycle = 1 + (i % 3);
+        stat.p1 = i & 0xFF;
+        stat.under = board.tiles.get(stat.x, stat.y);
+        if (i > 0 && (i % 4) == 0 && i >= 8) {
+            // objects sharing code with an earlier one
+            stat.data.bind(board.stats[i - 4].data);
+        } else if (i > 0 && (i % 2) == 0) {
+            BenchmarkText code;
+            code.append("@obj%d\r#cycle 1\r:loop\r/n/s/e/w\r#loop\r:touch\rHello %d!\r#end\r", i, i);
+            stat.data.alloc_data(code.len);
+            memcpy(stat.data.data, code.data, code.len);
+        }
+        board.tiles.set(stat.x, stat.y, {.element = (uint8_t) (i == 0 ? EPlayer : EObject), .color = 0x0F});
+    }
+}
+
+static void fixture_init(BenchmarkFixture &fixture) {
+    Random random(BENCH_SEED);
+    Game *game = new Game();
+    fixture.game = game;
+
+    game->driver = &fixture.driver;
+    game->filesystem = &fixture.filesystem;
+    game->Initialize();
+    game->interface = fixture.driver.create_user_interface(*game, false);
+    game->interface->ConfigureViewport(game->viewport.x, game->viewport.y, game->viewport.width, game->viewport.height);
+
+    // the current board: random tiles and objects
+    fill_tiles(game->board, random);
+    game->board.stats.count = 0;
+    game->board.stats[0].x = 1;
+    game->board.stats[0].y = 1;
+    game->board.tiles.set(1, 1, {.element = game->elementId(EPlayer), .color = 0x1F});
+    for (int16_t i = 1; i < BENCH_STAT_COUNT - 2; i++) {
+        int16_t x = 1 + ((i * 7) % game->board.width());
+        int16_t y = 1 + ((i * 7) / game->board.width());
+        Stat tpl = Stat();
+        game->AddStat(x, y, game->elementId(EObject), 0x0F, 3, tpl);
+    }
+    {
+        BenchmarkText code;
+        code.append("@bench\r:loop\r#set a\r#if a #clear a\r#give gems 1\r#take gems 1\r#cycle 1\r#loop\r");
+        Stat tpl = Stat();
+        tpl.data.alloc_data(code.len);
+        memcpy(tpl.data.data, code.data, code.len);
+        game->AddStat(game->board.width(), game->board.height(), game->elementId(EObject), 0x0F, 1, tpl);
+        tpl.data.free_data();
+        fixture.object_id = game->board.stats.count;
+    }
+    game->BoardUpdateDrawOffset();
+
+    // one large program, with a label on every fourth line
+    {
+        BenchmarkText code;
+        code.append("@program\r");
+        for (int i = 0; i < BENCH_PROGRAM_LINES; i++) {
+            switch (i & 3) {
+            case 0: code.append(":label%d\r", i); break;
+            case 1: code.append("#if flag%d #send label%d\r", i, (i * 7) % BENCH_PROGRAM_LINES); break;
+            case 2: code.append("Text line %d of the program.\r", i); break;
+            case 3: code.append("'comment%d\r", i); break;
+            }
+        }
+        code.append(":target\r#end\r");
+        fixture.program.data.alloc_data(code.len);
+        memcpy(fixture.program.data.data, code.data, code.len);
+    }
+
+    // boards to serialize
+    for (int f = 0; f < 2; f++) {
+        bool szzt = f == 1;
+        fixture.boards[f] = szzt ? new Board(96, 80, 128) : new Board(60, 25, 150);
+        fixture.scratch_boards[f] = szzt ? new Board(96, 80, 128) : new Board(60, 25, 150);
+        fill_board(*fixture.boards[f], random, szzt);
+
+        size_t size = bench_serializers[f]->estimate_board_size(*fixture.boards[f]);
+        fixture.board_data[f] = (uint8_t*) malloc(size);
+        MemoryIOStream stream(fixture.board_data[f], size, true);
+        bench_serializers[f]->serialize_board(*fixture.boards[f], stream, false);
+        fixture.board_len[f] = stream.tell();
+    }
+
+    // audio
+    fixture.simulators[0] = new AudioSimulator<int16_t>(&fixture.audio_queue, BENCH_AUDIO_FREQUENCY, true);
+    fixture.simulators[1] = new AudioSimulatorBandlimited<int16_t>(&fixture.audio_queue, BENCH_AUDIO_FREQUENCY, true);
+    fixture.music_len = SoundParse(bench_music, fixture.music, sizeof(fixture.music));
+
+    // a help file
+    for (int i = 0; i < BENCH_HELP_LINES; i++) {
+        switch (i % 5) {
+        case 0: fixture.help.append("$Centered heading %d\r\n", i); break;
+        case 1: fixture.help.append("!label%d;Hyperlink number %d\r\n", i, i); break;
+        case 2: fixture.help.append(":label%d;Label\r\n", i); break;
+        default: fixture.help.append("Plain text line %d, some forty characters.\r\n", i); break;
+        }
+    }
+    fixture.filesystem.data = (const uint8_t*) fixture.help.data;
+    fixture.filesystem.len = fixture.help.len;
+}
+
+static uint32_t hash_bytes(uint32_t hash, const uint8_t *data, size_t len) {
+    // FNV-1a
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ data[i]) * 16777619;
+    }
+    return hash;
+}
+
+// benchmarks
+
+static void setup_oop_execute(BenchmarkFixture &fixture) {
+    fixture.game->board.stats[fixture.object_id].data_pos = 0;
+    fixture.game->world.info.gems = 0;
+}
+
+static uint32_t bench_oop_execute(BenchmarkFixture &fixture, uint32_t iterations) {
+    Game &game = *fixture.game;
+    uint32_t result = 0;
+    for (uint32_t i = 0; i < iterations; i++) {
+        Stat &stat = game.board.stats[fixture.object_id];
+        game.OopExecute(fixture.object_id, stat.data_pos, "Interaction");
+        result += stat.data_pos;
+    }
+    return result;
+}
+
+static uint32_t bench_oop_find_string(BenchmarkFixture &fixture, uint32_t iterations) {
+    uint32_t result = 0;
+    for (uint32_t i = 0; i < iterations; i++) {
+        char search[16];
+        strcpy(search, "\r:target");
+        result += fixture.game->OopFindString(fixture.program, search);
+        strcpy(search, "\r:missing");
+        result += fixture.game->OopFindString(fixture.program, search);
+    }
+    return result;
+}
+
+static uint32_t bench_find_tile_on_board(BenchmarkFixture &fixture, uint32_t iterations) {
+    Game &game = *fixture.game;
+    Tile tile = {.element = game.elementId(EGem), .color = 0x0E};
+    uint32_t result = 0;
+    for (uint32_t i = 0; i < iterations; i++) {
+        int16_t x = 0, y = 1;
+        while (game.FindTileOnBoard(x, y, tile)) {
+            result += x + (y << 8);
+        }
+    }
+    return result;
+}
+
+static uint32_t bench_stat_id_at(BenchmarkFixture &fixture, uint32_t iterations) {
+    Board &board = fixture.game->board;
+    uint32_t result = 0;
+    for (uint32_t i = 0; i < iterations; i++) {
+        for (int16_t s = 0; s <= board.stats.count; s++) {
+            Stat &stat = board.stats[s];
+            result += board.stats.id_at(stat.x, stat.y);
+            result += board.stats.id_at(stat.x, 0); // miss
+        }
+    }
+    return result;
+}
+
+static uint32_t bench_serialize_board(BenchmarkFixture &fixture, int format, uint32_t iterations) {
+    Board &board = *fixture.boards[format];
+    size_t size = bench_serializers[format]->estimate_board_size(board);
+    uint8_t *buffer = (uint8_t*) malloc(size);
+    uint32_t result = 0;
+    for (uint32_t i = 0; i < iterations; i++) {
+        MemoryIOStream stream(buffer, size, true);
+        bench_serializers[format]->serialize_board(board, stream, false);
+        result += stream.tell();
+    }
+    result = hash_bytes(result, buffer, fixture.board_len[format]);
+    free(buffer);
+    return result;
+}
+
+static uint32_t bench_deserialize_board(BenchmarkFixture &fixture, int format, uint32_t iterations) {
+    Board &board = *fixture.scratch_boards[format];
+    uint32_t result = 0;
+    for (uint32_t i = 0; i < iterations; i++) {
+        MemoryIOStream stream(fixture.board_data[format], fixture.board_len[format]);
+        bench_serializers[format]->deserialize_board(board, stream, false);
+        result += board.stats.count;
+        board.stats.free_all_data();
+        board.arena.clear();
+    }
+    return hash_bytes(result, (const uint8_t*) board.tiles.data(), board.tiles.data_size() * sizeof(Tile));
+}
+
+static uint32_t bench_serialize_board_zzt(BenchmarkFixture &fixture, uint32_t iterations) {
+    return bench_serialize_board(fixture, 0, iterations);
+}
+
+static uint32_t bench_serialize_board_szt(BenchmarkFixture &fixture, uint32_t iterations) {
+    return bench_serialize_board(fixture, 1, iterations);
+}
+
+static uint32_t bench_deserialize_board_zzt(BenchmarkFixture &fixture, uint32_t iterations) {
+    return bench_deserialize_board(fixture, 0, iterations);
+}
+
+static uint32_t bench_deserialize_board_szt(BenchmarkFixture &fixture, uint32_t iterations) {
+    return bench_deserialize_board(fixture, 1, iterations);
+}
+
+static uint32_t bench_board_draw_tile(BenchmarkFixture &fixture, uint32_t iterations) {
+    Game &game = *fixture.game;
+    Viewport &viewport = game.viewport;
+    for (uint32_t i = 0; i < iterations; i++) {
+        for (int16_t ty = 0; ty < viewport.height; ty++) {
+            for (int16_t tx = 0; tx < viewport.width; tx++) {
+                game.BoardDrawTile(viewport.cx_offset + 1 + tx, viewport.cy_offset + 1 + ty);
+            }
+        }
+    }
+    return hash_bytes(2166136261U, fixture.driver.screen, sizeof(fixture.driver.screen));
+}
+
+static void setup_audio(BenchmarkFixture &fixture) {
+    fixture.audio_queue.clear();
+    fixture.simulators[0]->clear();
+    fixture.simulators[1]->clear();
+}
+
+// one PIT tick of samples per iteration
+static uint32_t bench_audio_simulate(BenchmarkFixture &fixture, int idx, uint32_t iterations) {
+    AudioSimulator<int16_t> *simulator = fixture.simulators[idx];
+    size_t len = BENCH_AUDIO_FREQUENCY * 11 / 2000;
+    for (uint32_t i = 0; i < iterations; i++) {
+        if (!fixture.audio_queue.is_playing()) {
+            fixture.audio_queue.queue(-1, fixture.music, fixture.music_len);
+        }
+        simulator->allowed = true;
+        simulator->simulate(fixture.audio_buffer, len);
+    }
+    return hash_bytes(2166136261U, (const uint8_t*) fixture.audio_buffer, len * sizeof(int16_t));
+}
+
+static uint32_t bench_audio_simulate_square(BenchmarkFixture &fixture, uint32_t iterations) {
+    return bench_audio_simulate(fixture, 0, iterations);
+}
+
+static uint32_t bench_audio_simulate_bandlimited(BenchmarkFixture &fixture, uint32_t iterations) {
+    return bench_audio_simulate(fixture, 1, iterations);
+}
+
+static uint32_t bench_sound_parse(BenchmarkFixture &fixture, uint32_t iterations) {
+    uint8_t output[255];
+    uint32_t result = 0;
+    for (uint32_t i = 0; i < iterations; i++) {
+        size_t len = SoundParse(bench_music, output, sizeof(output));
+        result += len + output[i % len];
+    }
+    return result;
+}
+
+static uint32_t bench_text_window_open_file(BenchmarkFixture &fixture, uint32_t iterations) {
+    TextWindow window(&fixture.driver, &fixture.filesystem, 5, 3, 50, 18);
+    uint32_t result = 0;
+    for (uint32_t i = 0; i < iterations; i++) {
+        window.OpenFile("BENCH.HLP", false);
+        result += window.line_count;
+    }
+    return result;
+}
+
+static uint32_t bench_text_window_view_file(BenchmarkFixture &fixture, uint32_t iterations) {
+    TextWindow window(&fixture.driver, &fixture.filesystem, 5, 3, 50, 18);
+    uint32_t result = 0;
+    for (uint32_t i = 0; i < iterations; i++) {
+        window.ViewFile("BENCH.HLP", false);
+        result += window.line_count;
+    }
+    return result;
+}
+
+struct Benchmark {
+    const char *name;
+    void (*setup)(BenchmarkFixture &fixture);
+    uint32_t (*run)(BenchmarkFixture &fixture, uint32_t iterations);
+};
+
+static const Benchmark benchmarks[] = {
+    {"oop_find_string", nullptr, bench_oop_find_string},
+    {"oop_execute", setup_oop_execute, bench_oop_execute},
+    {"find_tile_on_board", nullptr, bench_find_tile_on_board},
+    {"stat_id_at", nullptr, bench_stat_id_at},
+    {"serialize_board_zzt", nullptr, bench_serialize_board_zzt},
+    {"deserialize_board_zzt", nullptr, bench_deserialize_board_zzt},
+    {"serialize_board_szt", nullptr, bench_serialize_board_szt},
+    {"deserialize_board_szt", nullptr, bench_deserialize_board_szt},
+    {"board_draw_tile_viewport", nullptr, bench_board_draw_tile},
+    {"audio_simulate", setup_audio, bench_audio_simulate_square},
+    {"audio_simulate_bandlimited", setup_audio, bench_audio_simulate_bandlimited},
+    {"sound_parse", nullptr, bench_sound_parse},
+    {"text_window_open_file", nullptr, bench_text_window_open_file},
+    {"text_window_view_file", nullptr, bench_text_window_view_file}
+};
+
+static uint64_t bench_now_ns(void) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void print_usage(const char *name) {
+    fprintf(stderr, "Usage: %s [options] [benchmark...]\n", name);
+    fprintf(stderr, "  -t <ms>       target time per run (default 100)\n");
+    fprintf(stderr, "  -r <runs>     runs per benchmark; the fastest is reported (default 5)\n");
+    fprintf(stderr, "  -l            list the benchmarks\n");
+    fprintf(stderr, "Benchmarks are selected by name prefix; all run by default.\n");
+}
+
+int main(int argc, char** argv) {
+    uint32_t target_ms = 100;
+    uint32_t runs = 5;
+    int names_start = argc;
+
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] == '-' && argv[i][1] != 0 && argv[i][2] == 0) {
+            char opt = argv[i][1];
+            if (opt == 'l') {
+                for (const Benchmark &benchmark : benchmarks) {
+                    printf("%s\n", benchmark.name);
+                }
+                return 0;
+            } else if ((i + 1) < argc) {
+                const char *value = argv[++i];
+                switch (opt) {
+                case 't': target_ms = strtoul(value, nullptr, 10); continue;
+                case 'r': runs = strtoul(value, nullptr, 10); continue;
+                }
+            }
+            print_usage(argv[0]);
+            return 1;
+        } else {
+            names_start = i;
+            break;
+        }
+    }
+
+    if (target_ms == 0 || runs == 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    BenchmarkFixture *fixture = new BenchmarkFixture();
+    fixture_init(*fixture);
+
+    printf("# benchmark iterations ns/iteration checksum\n");
+    for (const Benchmark &benchmark : benchmarks) {
+        if (names_start < argc) {
+            bool selected = false;
+            for (int i = names_start; i < argc; i++) {
+                if (strncmp(benchmark.name, argv[i], strlen(argv[i])) == 0) {
+                    selected = true;
+                    break;
+                }
+            }
+            if (!selected) continue;
+        }
+
+        if (benchmark.setup != nullptr) benchmark.setup(*fixture);
+        uint32_t checksum = benchmark.run(*fixture, 1);
+
+        // Calibrate: double the iteration count until a run takes at least
+        // a tenth of the target, then scale it up to the target.
+        uint64_t target_ns = (uint64_t) target_ms * 1000000;
+        uint32_t iterations = 1;
+        uint64_t elapsed_ns;
+        while (true) {
+            uint64_t start_ns = bench_now_ns();
+            benchmark.run(*fixture, iterations);
+            elapsed_ns = bench_now_ns() - start_ns;
+            if (elapsed_ns >= (target_ns / 10) || iterations >= (UINT32_MAX / 2)) break;
+            iterations *= 2;
+        }
+        if (elapsed_ns > 0 && elapsed_ns < target_ns) {
+            uint64_t scaled = (uint64_t) iterations * target_ns / elapsed_ns;
+            iterations = scaled > UINT32_MAX ? UINT32_MAX : scaled;
+        }
+
+        double best_ns = 0;
+        for (uint32_t run = 0; run < runs; run++) {
+            uint64_t start_ns = bench_now_ns();
+            benchmark.run(*fixture, iterations);
+            double ns = (double) (bench_now_ns() - start_ns) / iterations;
+            if (run == 0 || ns < best_ns) best_ns = ns;
+        }
+
+        printf("%s %u %.1f %08X\n", benchmark.name, iterations, best_ns, checksum);
+        fflush(stdout);
+    }
+
+    return 0;
+}
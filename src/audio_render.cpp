@@ -0,0 +1,217 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "audio_simulator.h"
+#include "audio_simulator_bandlimited.h"
+#include "sounds.h"
+
+/*
+  Offline sound renderer: drives the audio simulator directly, as fast as
+  possible, and writes the result to a 16-bit mono WAV file.
+
+  Input is either music strings in #PLAY syntax, queued at the start as if
+  played by consecutive #PLAY commands, or a recording of sound_queue() calls
+  as written by the capture driver (-a), one call per line:
+
+    <PIT tick> Q <priority> <pattern as hex>
+    <PIT tick> C                              (queue cleared)
+*/
+
+using namespace ZZT;
+
+// Give up on recordings whose last sound never ends (~1 hour).
+#define MAX_TAIL_PIT_TICKS 65536
+
+struct SoundEvent {
+    uint32_t tick;
+    bool clear;
+    int16_t priority;
+    uint8_t len;
+    uint8_t pattern[255];
+};
+
+static void write_u16(FILE *file, uint16_t value) {
+    fputc(value & 0xFF, file);
+    fputc(value >> 8, file);
+}
+
+static void write_u32(FILE *file, uint32_t value) {
+    write_u16(file, value & 0xFFFF);
+    write_u16(file, value >> 16);
+}
+
+static void write_wav_header(FILE *file, uint32_t frequency, uint32_t samples) {
+    fwrite("RIFF", 1, 4, file);
+    write_u32(file, 36 + samples * 2);
+    fwrite("WAVEfmt ", 1, 8, file);
+    write_u32(file, 16);
+    write_u16(file, 1); // PCM
+    write_u16(file, 1); // mono
+    write_u32(file, frequency);
+    write_u32(file, frequency * 2);
+    write_u16(file, 2);
+    write_u16(file, 16);
+    fwrite("data", 1, 4, file);
+    write_u32(file, samples * 2);
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+static bool read_event(FILE *file, SoundEvent &event) {
+    char line[1024];
+    while (fgets(line, sizeof(line), file) != nullptr) {
+        char type;
+        int priority = 0;
+        char hex[600];
+        int fields = sscanf(line, "%u %c %d %599s", &event.tick, &type, &priority, hex);
+        if (fields >= 2 && type == 'C') {
+            event.clear = true;
+            return true;
+        } else if (fields == 4 && type == 'Q') {
+            event.clear = false;
+            event.priority = priority;
+            event.len = 0;
+            for (int i = 0; hex[i] != 0 && hex[i + 1] != 0 && event.len < sizeof(event.pattern); i += 2) {
+                int hi = hex_value(hex[i]);
+                int lo = hex_value(hex[i + 1]);
+                if (hi < 0 || lo < 0) break;
+                event.pattern[event.len++] = (hi << 4) | lo;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+static void print_usage(const char *name) {
+    fprintf(stderr, "Usage: %s [options] -o <output.wav> [music...]\n", name);
+    fprintf(stderr, "  -o <file>     output WAV file\n");
+    fprintf(stderr, "  -i <file>     sound_queue() recording to render instead of music strings\n");
+    fprintf(stderr, "  -r <rate>     sample rate (default 48000)\n");
+    fprintf(stderr, "  -v <volume>   volume, 0-127 (default 64)\n");
+    fprintf(stderr, "  -b            use the band-limited simulator\n");
+}
+
+int main(int argc, char** argv) {
+    const char *output_name = nullptr;
+    const char *recording_name = nullptr;
+    int frequency = 48000;
+    int volume = 64;
+    bool bandlimited = false;
+    int music_start = argc;
+
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] == '-' && argv[i][1] != 0 && argv[i][2] == 0) {
+            char opt = argv[i][1];
+            if (opt == 'b') {
+                bandlimited = true;
+                continue;
+            } else if ((i + 1) < argc) {
+                const char *value = argv[++i];
+                switch (opt) {
+                case 'o': output_name = value; continue;
+                case 'i': recording_name = value; continue;
+                case 'r': frequency = atoi(value); continue;
+                case 'v': volume = atoi(value); continue;
+                }
+            }
+            print_usage(argv[0]);
+            return 1;
+        } else {
+            music_start = i;
+            break;
+        }
+    }
+
+    if (output_name == nullptr || frequency <= 0 || volume < 0 || volume > 127
+        || (recording_name == nullptr && music_start >= argc)) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    FILE *recording = nullptr;
+    if (recording_name != nullptr) {
+        recording = fopen(recording_name, "r");
+        if (recording == nullptr) {
+            fprintf(stderr, "Could not open %s\n", recording_name);
+            return 1;
+        }
+    }
+
+    FILE *output = fopen(output_name, "wb");
+    if (output == nullptr) {
+        fprintf(stderr, "Could not open %s\n", output_name);
+        return 1;
+    }
+    write_wav_header(output, frequency, 0);
+
+    SoundQueue queue;
+    AudioSimulator<int16_t> *simulator = bandlimited
+        ? new AudioSimulatorBandlimited<int16_t>(&queue, frequency, true)
+        : new AudioSimulator<int16_t>(&queue, frequency, true);
+    simulator->set_volume(volume);
+
+    for (int i = music_start; i < argc; i++) {
+        uint8_t buf[255];
+        int buflen = SoundParse(argv[i], buf, sizeof(buf));
+        if (buflen > 0) {
+            queue.queue(-1, buf, buflen);
+        }
+    }
+
+    SoundEvent event;
+    bool has_event = recording != nullptr && read_event(recording, event);
+
+    int16_t *buffer = (int16_t*) malloc(sizeof(int16_t) * (frequency / 10 + 1));
+    uint32_t samples_written = 0;
+    uint32_t tail_ticks = 0;
+    for (uint32_t tick = 0; has_event || queue.is_playing(); tick++) {
+        while (has_event && event.tick <= tick) {
+            if (event.clear) {
+                queue.clear();
+                simulator->clear();
+            } else {
+                queue.queue(event.priority, event.pattern, event.len);
+            }
+            has_event = read_event(recording, event);
+        }
+
+        if (!has_event && ++tail_ticks > MAX_TAIL_PIT_TICKS) {
+            fprintf(stderr, "Sound did not stop, truncating output\n");
+            break;
+        }
+
+        // as the SDL driver does on every PIT tick
+        simulator->allowed = queue.is_playing();
+
+        // 5.5 hsecs per PIT tick, with no drift between ticks
+        uint32_t tick_start = (uint64_t) tick * frequency * 11 / 200;
+        uint32_t tick_end = (uint64_t) (tick + 1) * frequency * 11 / 200;
+        uint32_t len = tick_end - tick_start;
+        simulator->simulate(buffer, len);
+        for (uint32_t i = 0; i < len; i++) {
+            write_u16(output, buffer[i]);
+        }
+        samples_written += len;
+    }
+
+    fseek(output, 0, SEEK_SET);
+    write_wav_header(output, frequency, samples_written);
+    fclose(output);
+
+    if (recording != nullptr) {
+        fclose(recording);
+    }
+    free(buffer);
+    delete simulator;
+
+    fprintf(stderr, "%s: %u samples (%.2f seconds)\n", output_name, samples_written, samples_written / (double) frequency);
+    return 0;
+}
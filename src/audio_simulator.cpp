@@ -8,17 +8,37 @@
 
 using namespace ZZT;
 
-/*
-  Known issues:
-  - currently hardcoded to unsigned 8-bit samples
-*/
-
 #define PIT_DIVISOR 1193182
 #define SAMPLES_NOTE_DELAY 16
 
 // longest sample would be 2640 * 256 = 675840 samples
 #define FIXED_SHIFT 9
 
+// Output is written as runs of constant level; these loops are kept simple
+// enough for the compiler to turn into vector stores.
+template<typename SampleFormat>
+static inline void fill_samples(SampleFormat *stream, SampleFormat value, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        stream[i] = value;
+    }
+}
+
+template<>
+inline void fill_samples<uint8_t>(uint8_t *stream, uint8_t value, uint32_t count) {
+    memset(stream, value, count);
+}
+
+// Edge sample: from -> to, pos in 0..(1 << FIXED_SHIFT)
+template<typename SampleFormat>
+static inline SampleFormat mix_samples(SampleFormat from, SampleFormat to, uint32_t pos) {
+    return (((int32_t) from * (int32_t) ((1 << FIXED_SHIFT) - pos)) + ((int32_t) to * (int32_t) pos)) >> FIXED_SHIFT;
+}
+
+template<>
+inline float mix_samples<float>(float from, float to, uint32_t pos) {
+    return ((from * ((1 << FIXED_SHIFT) - pos)) + (to * pos)) * (1.0f / (1 << FIXED_SHIFT));
+}
+
 template<typename SampleFormat>
 uint32_t AudioSimulator<SampleFormat>::calc_jump(uint32_t targetNotePos, int32_t streamPos, int32_t streamLen) {
     int32_t maxTargetChange = targetNotePos - current_note_pos;
@@ -64,28 +84,43 @@ void AudioSimulator<SampleFormat>::note_to(uint32_t targetNotePos, uint32_t freq
         uint32_t pit_ticks = PIT_DIVISOR / frequency;
         uint32_t samplesPerChange = ((uint64_t) (audio_frequency * pit_ticks) << FIXED_SHIFT) / PIT_DIVISOR;
 
+        uint32_t halfChange = samplesPerChange >> 1;
         uint32_t stepSize = (1 << FIXED_SHIFT);
         uint32_t samplePos = (current_note_pos << FIXED_SHIFT) % samplesPerChange;
-        for (uint32_t i = 0; i < iMax; i++, samplePos += stepSize) {
+        SampleFormat *out = stream + streamPos;
+
+        for (uint32_t i = 0; i < iMax; ) {
             while (samplePos >= samplesPerChange) samplePos -= samplesPerChange;
-            if (samplePos < (samplesPerChange >> 1)) {
+
+            uint32_t runEnd;
+            SampleFormat level;
+            if (samplePos < halfChange) {
                 if (samplePos < stepSize) {
                     // transition from max to min
-                    SampleFormat trans_val = ((sample_max * (stepSize - samplePos)) + (sample_min * samplePos)) >> FIXED_SHIFT;
-                    stream[streamPos + i] = trans_val;
-                } else {
-                    stream[streamPos + i] = sample_min;
+                    out[i++] = mix_samples(sample_max, sample_min, samplePos);
+                    samplePos += stepSize;
+                    continue;
                 }
+                runEnd = halfChange;
+                level = sample_min;
             } else {
-                int midPos = samplePos - (samplesPerChange >> 1);
+                uint32_t midPos = samplePos - halfChange;
                 if (midPos < stepSize) {
                     // transition from min to max
-                    SampleFormat trans_val = ((sample_min * (stepSize - midPos)) + (sample_max * midPos)) >> FIXED_SHIFT;
-                    stream[streamPos + i] = trans_val;
-                } else {
-                    stream[streamPos + i] = sample_max;
+                    out[i++] = mix_samples(sample_min, sample_max, midPos);
+                    samplePos += stepSize;
+                    continue;
                 }
+                runEnd = samplesPerChange;
+                level = sample_max;
             }
+
+            // all samples until the next edge share the same level
+            uint32_t run = (runEnd - samplePos + stepSize - 1) >> FIXED_SHIFT;
+            if (run > (iMax - i)) run = iMax - i;
+            fill_samples(out + i, level, run);
+            i += run;
+            samplePos += run << FIXED_SHIFT;
         }
 #endif
     }
@@ -97,9 +132,7 @@ template<typename SampleFormat>
 void AudioSimulator<SampleFormat>::silence_to(uint32_t targetNotePos, SampleFormat *stream, int32_t &streamPos, int32_t streamLen) {
     uint32_t iMax = calc_jump(targetNotePos, streamPos, streamLen);
     if (iMax > 0) {
-        for (uint32_t i = 0; i < iMax; i++) {
-            stream[streamPos + i] = sample_none;
-        }
+        fill_samples(stream + streamPos, sample_none, iMax);
     }
     jump_by(iMax, streamPos);
 }
@@ -109,14 +142,16 @@ AudioSimulator<SampleFormat>::AudioSimulator(SoundQueue *queue, int audio_freque
     this->queue = queue;
     this->allowed = false;
     this->audio_signed = audio_signed;
-    clear();
+    this->current_note = -1;
+    this->clear_requested = false;
     set_volume(64);
     set_frequency(audio_frequency);
 }
 
 template<typename SampleFormat>
 void AudioSimulator<SampleFormat>::clear(void) {
-    this->current_note = -1;
+    // applied by the audio thread on its next simulate() call
+    this->clear_requested.store(true, std::memory_order_release);
 }
 
 template<typename SampleFormat>
@@ -124,6 +159,11 @@ int AudioSimulator<SampleFormat>::volume(void) const {
     return this->sample_none - this->sample_min;
 }
 
+template<>
+int AudioSimulator<float>::volume(void) const {
+    return (int) ((this->sample_none - this->sample_min) * 128.0f + 0.5f);
+}
+
 template<>
 void AudioSimulator<uint8_t>::set_volume(int volume) {
     this->sample_none = 128;
@@ -150,6 +190,21 @@ void AudioSimulator<uint16_t>::set_volume(int volume) {
     }
 }
 
+// signed formats are always signed; audio_signed only applies to unsigned ones
+template<>
+void AudioSimulator<int16_t>::set_volume(int volume) {
+    this->sample_none = 0;
+    this->sample_min = -(volume << 8);
+    this->sample_max = (volume << 8);
+}
+
+template<>
+void AudioSimulator<float>::set_volume(int volume) {
+    this->sample_none = 0.0f;
+    this->sample_min = -(volume / 128.0f);
+    this->sample_max = (volume / 128.0f);
+}
+
 template<typename SampleFormat>
 void AudioSimulator<SampleFormat>::set_frequency(int frequency) {
     audio_frequency = frequency;
@@ -159,21 +214,21 @@ void AudioSimulator<SampleFormat>::set_frequency(int frequency) {
 
 template<typename SampleFormat>
 void AudioSimulator<SampleFormat>::simulate(SampleFormat *stream, size_t len) {
-    if (!queue->enabled || !queue->is_playing || !allowed) {
+    if (clear_requested.load(std::memory_order_acquire)) {
+        clear_requested.store(false, std::memory_order_relaxed);
+        current_note = -1;
+    }
+
+    if (!queue->enabled || !queue->is_playing() || !allowed) {
         current_note = -1;
-		for (int i = 0; i < len; i++) {
-			stream[i] = sample_none;
-		}
+        fill_samples(stream, sample_none, len);
     } else {
         int32_t pos = 0;
         while (pos < len) {
             if (current_note < 0) {
                 uint16_t note, duration;
                 if (!queue->pop(note, duration)) {
-                    queue->is_playing = false;
-					for (int i = pos; i < len; i++) {
-						stream[i] = sample_none;
-					}
+                    fill_samples(stream + pos, sample_none, len - pos);
                     break;
                 } else {
                     current_note = note;
@@ -211,4 +266,6 @@ void AudioSimulator<SampleFormat>::simulate(SampleFormat *stream, size_t len) {
 }
 
 template class ZZT::AudioSimulator<uint8_t>;
-template class ZZT::AudioSimulator<uint16_t>;
\ No newline at end of file
+template class ZZT::AudioSimulator<uint16_t>;
+template class ZZT::AudioSimulator<int16_t>;
+template class ZZT::AudioSimulator<float>;
\ No newline at end of file
@@ -3,6 +3,7 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <atomic>
 #include "sounds.h"
 
 namespace ZZT {
@@ -22,6 +23,7 @@ namespace ZZT {
         int32_t current_note;
         uint32_t current_note_pos;
         uint32_t current_note_max;
+        std::atomic<bool> clear_requested;
     
         uint32_t calc_jump(uint32_t targetNotePos, int32_t streamPos, int32_t streamLen);
         void jump_by(uint32_t amount, int32_t &streamPos);
@@ -35,7 +37,7 @@ namespace ZZT {
         virtual ~AudioSimulator() { }
         int volume() const;
         void set_volume(int volume); /* 0 .. 127 */
-        void set_frequency(int frequency);
+        virtual void set_frequency(int frequency);
         void clear(void);
         void simulate(SampleFormat *stream, size_t len);
     };
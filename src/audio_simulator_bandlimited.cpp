@@ -19,63 +19,187 @@ using namespace ZZT;
 #define FIXED_SHIFT_STEP 8
 #define TRIG_SHIFT 14
 #define COEFF_MAX 512
+// The waveform only depends on the number of harmonics below the Nyquist
+// frequency, so one table serves every PIT divisor with that count.
+// Entries are spaced 1 << WAVE_FRAC_SHIFT phase steps apart and
+// linearly interpolated.
+#define WAVE_SHIFT 13
+#define WAVE_FRAC_SHIFT (TRIG_SHIFT - WAVE_SHIFT)
+
+// Waveform sample (-1 << TRIG_SHIFT .. 1 << TRIG_SHIFT) -> output sample
+template<typename SampleFormat>
+static inline SampleFormat scale_sample(int32_t sample, SampleFormat sample_min, SampleFormat sample_max) {
+    sample = ((((sample) + (1 << TRIG_SHIFT)) * (sample_max - sample_min)) >> (TRIG_SHIFT + 1)) + sample_min;
+    if (sample < sample_min) sample = sample_min;
+    else if (sample > sample_max) sample = sample_max;
+    return sample;
+}
+
+template<>
+inline float scale_sample<float>(int32_t sample, float sample_min, float sample_max) {
+    float value = ((sample + (1 << TRIG_SHIFT)) * (sample_max - sample_min) * (1.0f / (2 << TRIG_SHIFT))) + sample_min;
+    if (value < sample_min) value = sample_min;
+    else if (value > sample_max) value = sample_max;
+    return value;
+}
+
+// Number of harmonics of a note which lie below the Nyquist frequency.
+static int wave_harmonics(int audio_frequency, uint32_t frequency) {
+    uint32_t pit_ticks = PIT_DIVISOR / frequency;
+    uint32_t freq_real_fixed = (PIT_DIVISOR << FIXED_SHIFT) / pit_ticks;
+
+    int harmonics = ((audio_frequency << (FIXED_SHIFT - 1)) - 1) / freq_real_fixed;
+    if (harmonics >= COEFF_MAX) harmonics = COEFF_MAX - 1;
+    return harmonics;
+}
 
 template<typename SampleFormat>
 AudioSimulatorBandlimited<SampleFormat>::AudioSimulatorBandlimited(SoundQueue *queue, int audio_frequency, bool audio_signed)
     : AudioSimulator<SampleFormat>(queue, audio_frequency, audio_signed) {
     this->cos_table = (int16_t*) malloc(sizeof(int16_t) * (1 << TRIG_SHIFT));
     this->coeff_table = (int16_t*) malloc(sizeof(int16_t) * COEFF_MAX);
+    this->wave_tables = (int16_t**) calloc(COEFF_MAX, sizeof(int16_t*));
+    this->wave_tables_frequency = 0;
 
-    for (int i = 0; i < (1 << (TRIG_SHIFT)); i++) {
-        cos_table[i] = cosf(2 * M_PI * (i / (float) (1 << TRIG_SHIFT))) * 16384;
+    if (cos_table != nullptr) {
+        for (int i = 0; i < (1 << (TRIG_SHIFT)); i++) {
+            cos_table[i] = cosf(2 * M_PI * (i / (float) (1 << TRIG_SHIFT))) * 16384;
+        }
     }
-    coeff_table[0] = 0;
-    for (int i = 1; i < COEFF_MAX; i++) {
-        coeff_table[i] = 32768 * sinf(0.5 * i * M_PI) / (i * M_PI);
+    if (coeff_table != nullptr) {
+        coeff_table[0] = 0;
+        for (int i = 1; i < COEFF_MAX; i++) {
+            coeff_table[i] = 32768 * sinf(0.5 * i * M_PI) / (i * M_PI);
+        }
     }
+
+    // the base constructor's set_frequency() call does not reach ours
+    build_wave_tables();
 }
 
 template<typename SampleFormat>
 AudioSimulatorBandlimited<SampleFormat>::~AudioSimulatorBandlimited() {
+    if (this->wave_tables != nullptr) {
+        for (int i = 0; i < COEFF_MAX; i++) {
+            free(this->wave_tables[i]);
+        }
+    }
+    free(this->wave_tables);
     free(this->coeff_table);
     free(this->cos_table);
 }
 
+template<typename SampleFormat>
+void AudioSimulatorBandlimited<SampleFormat>::set_frequency(int frequency) {
+    AudioSimulator<SampleFormat>::set_frequency(frequency);
+    build_wave_tables();
+}
+
+template<typename SampleFormat>
+int16_t *AudioSimulatorBandlimited<SampleFormat>::build_wave_table(int harmonics) {
+    // one extra entry, so that interpolation never has to wrap
+    int16_t *table = (int16_t*) malloc(sizeof(int16_t) * ((1 << WAVE_SHIFT) + 1));
+    if (table == nullptr) {
+        return nullptr;
+    }
+
+    for (int i = 0; i < (1 << WAVE_SHIFT); i++) {
+        uint32_t cos_indice = i << WAVE_FRAC_SHIFT;
+        int32_t sample = 0;
+        // only odd harmonics have non-zero coefficients
+        for (int coeff_pos = 1; coeff_pos <= harmonics; coeff_pos += 2) {
+            sample += ((int64_t) coeff_table[coeff_pos] * cos_table[(cos_indice * coeff_pos) & ((1 << TRIG_SHIFT) - 1)]);
+        }
+        table[i] = sample >> TRIG_SHIFT;
+    }
+    table[1 << WAVE_SHIFT] = table[0];
+    return table;
+}
+
+// Build the table for every note and drum frequency at the current audio
+// frequency, and drop the ones no longer reachable. Tables which fail to
+// allocate are left out; note_to() then plays a plain square wave.
+template<typename SampleFormat>
+void AudioSimulatorBandlimited<SampleFormat>::build_wave_tables(void) {
+    if (cos_table == nullptr || coeff_table == nullptr || wave_tables == nullptr) {
+        return;
+    }
+    if (wave_tables_frequency == this->audio_frequency) {
+        return;
+    }
+    wave_tables_frequency = this->audio_frequency;
+
+    bool needed[COEFF_MAX];
+    memset(needed, 0, sizeof(needed));
+    for (int i = 0; i < NOTE_MAX - NOTE_MIN; i++) {
+        if (sound_notes[i] > 0) {
+            needed[wave_harmonics(this->audio_frequency, sound_notes[i])] = true;
+        }
+    }
+    for (int i = 0; i < DRUM_MAX - DRUM_MIN; i++) {
+        const SoundDrum &drum = sound_drums[i];
+        for (int j = 0; j < drum.len; j++) {
+            if (drum.data[j] > 0) {
+                needed[wave_harmonics(this->audio_frequency, drum.data[j])] = true;
+            }
+        }
+    }
+
+    for (int i = 0; i < COEFF_MAX; i++) {
+        if (!needed[i]) {
+            free(wave_tables[i]);
+            wave_tables[i] = nullptr;
+        } else if (wave_tables[i] == nullptr) {
+            wave_tables[i] = build_wave_table(i);
+        }
+    }
+}
+
 template<typename SampleFormat>
 void AudioSimulatorBandlimited<SampleFormat>::note_to(uint32_t targetNotePos, uint32_t frequency, SampleFormat *stream, int32_t &streamPos, int32_t streamLen) {
     uint32_t iMax = this->calc_jump(targetNotePos, streamPos, streamLen);
 
     if (iMax > 0) {
+        const int16_t *table = wave_tables != nullptr
+            ? wave_tables[wave_harmonics(this->audio_frequency, frequency)] : nullptr;
+        if (table == nullptr) {
+            // never allocate here; this runs in the audio callback
+            AudioSimulator<SampleFormat>::note_to(targetNotePos, frequency, stream, streamPos, streamLen);
+            return;
+        }
+
         uint32_t pit_ticks = PIT_DIVISOR / frequency;
         uint32_t freq_real_fixed = (PIT_DIVISOR << FIXED_SHIFT) / pit_ticks;
 
-        uint32_t stepSize = (1 << FIXED_SHIFT_STEP);
-        uint32_t samplePos = (this->current_note_pos << FIXED_SHIFT_STEP);
-
-        for (uint32_t i = 0; i < iMax; i++, samplePos += stepSize) {
-            int32_t sample = 0;
-            int coeff_pos = 1;
-            uint64_t cos_indice = ((uint64_t) freq_real_fixed * samplePos / this->audio_frequency);
-            int pos = freq_real_fixed;
-            
-            while (pos < (this->audio_frequency << (FIXED_SHIFT - 1)) && coeff_pos < COEFF_MAX) {
-                // -(1 << 28) = 0
-                // (1 << 28) = 1
-                sample += ((int64_t) coeff_table[coeff_pos] * cos_table[(cos_indice * coeff_pos) & ((1 << TRIG_SHIFT) - 1)]);
-
-                pos += freq_real_fixed;
-                coeff_pos++;
+        // cos_indice = freq_real_fixed * (note_pos << FIXED_SHIFT_STEP) / audio_frequency,
+        // stepped per sample as quotient and remainder to avoid a division
+        uint64_t phase_numer = (uint64_t) freq_real_fixed << FIXED_SHIFT_STEP;
+        uint32_t phase_step = phase_numer / this->audio_frequency;
+        uint32_t phase_step_rem = phase_numer % this->audio_frequency;
+        uint64_t phase_start = phase_numer * this->current_note_pos;
+        uint32_t phase = phase_start / this->audio_frequency;
+        uint32_t phase_rem = phase_start % this->audio_frequency;
+
+        for (uint32_t i = 0; i < iMax; i++) {
+            uint32_t cos_indice = phase & ((1 << TRIG_SHIFT) - 1);
+            const int16_t *entry = table + (cos_indice >> WAVE_FRAC_SHIFT);
+            int32_t frac = cos_indice & ((1 << WAVE_FRAC_SHIFT) - 1);
+            int32_t sample = entry[0] + (((entry[1] - entry[0]) * frac) >> WAVE_FRAC_SHIFT);
+
+            phase += phase_step;
+            phase_rem += phase_step_rem;
+            if (phase_rem >= (uint32_t) this->audio_frequency) {
+                phase_rem -= this->audio_frequency;
+                phase++;
             }
 
-            sample = ((((sample >> TRIG_SHIFT) + (1 << TRIG_SHIFT)) * (this->sample_max - this->sample_min)) >> (TRIG_SHIFT + 1)) + this->sample_min;
-            if (sample < this->sample_min) sample = this->sample_min;
-            else if (sample > this->sample_max) sample = this->sample_max;
-
-            stream[streamPos + i] = sample;
+            stream[streamPos + i] = scale_sample(sample, this->sample_min, this->sample_max);
         }
     }
 
     this->jump_by(iMax, streamPos);
 }
 
-template class ZZT::AudioSimulatorBandlimited<uint16_t>;
\ No newline at end of file
+template class ZZT::AudioSimulatorBandlimited<uint16_t>;
+template class ZZT::AudioSimulatorBandlimited<int16_t>;
+template class ZZT::AudioSimulatorBandlimited<float>;
\ No newline at end of file
@@ -9,6 +9,14 @@ namespace ZZT {
     private:
         int16_t *cos_table;
         int16_t *coeff_table;
+        // single-cycle waveforms, indexed by harmonic count; only the counts
+        // reachable at the current audio frequency are built, ahead of
+        // playback, as simulate() runs in the audio callback
+        int16_t **wave_tables;
+        int wave_tables_frequency;
+
+        int16_t *build_wave_table(int harmonics);
+        void build_wave_tables(void);
 
     protected:
         virtual void note_to(uint32_t targetNotePos, uint32_t frequency, SampleFormat *stream, int32_t &streamPos, int32_t streamLen);
@@ -16,6 +24,7 @@ namespace ZZT {
     public:
         AudioSimulatorBandlimited(SoundQueue *queue, int audio_frequency, bool audio_signed);
         virtual ~AudioSimulatorBandlimited();
+        void set_frequency(int frequency) override;
     };
 };
 
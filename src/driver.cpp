@@ -3,6 +3,7 @@
 #include <cstring>
 #include "driver.h"
 #include "gamevars.h"
+#include "replay.h"
 #include "utils/mathutils.h"
 
 using namespace ZZT;
@@ -27,6 +28,8 @@ Driver::Driver(void) {
     joy_buttons_pressed_new = 0;
     joy_repeat_hsecs_delay = 25;
     joy_repeat_hsecs_delay_next = 4;
+
+    recorder = nullptr;
 }
 
 /* INPUT */
@@ -212,6 +215,12 @@ void Driver::advance_input() {
 	} else {
 		shiftAccepted = false;
 	}
+
+    if (recorder != nullptr) {
+        InputState state;
+        get_input_state(state);
+        recorder->record_input(state);
+    }
 }
 
 bool Driver::key_modifier_held(KeyModifier modifier) {
@@ -231,6 +240,30 @@ bool Driver::joy_button_held(JoyButton button, bool simulate) {
     return result || joy_button_pressed(button, simulate);
 }
 
+void Driver::get_input_state(InputState &state) const {
+    state.deltaX = deltaX;
+    state.deltaY = deltaY;
+    state.keyPressed = keyPressed;
+    state.shiftPressed = shiftPressed;
+    state.shiftAccepted = shiftAccepted;
+    state.joystickEnabled = joystickEnabled;
+    state.key_modifiers = key_modifiers;
+    state.joy_buttons_pressed = joy_buttons_pressed;
+    state.joy_buttons_held = joy_buttons_held;
+}
+
+void Driver::set_input_state(const InputState &state) {
+    deltaX = state.deltaX;
+    deltaY = state.deltaY;
+    keyPressed = state.keyPressed;
+    shiftPressed = state.shiftPressed;
+    shiftAccepted = state.shiftAccepted;
+    joystickEnabled = state.joystickEnabled;
+    key_modifiers = state.key_modifiers;
+    joy_buttons_pressed = state.joy_buttons_pressed;
+    joy_buttons_held = state.joy_buttons_held;
+}
+
 void Driver::set_text_input(bool enabled, InputPromptMode mode) {
     
 }
@@ -248,9 +281,7 @@ void Driver::read_wait_key(void) {
 /* SOUND/TIMER */
 
 void Driver::sound_clear_queue(void) {
-    sound_lock();
     _queue.clear();
-    sound_unlock();
     sound_stop();
 }
 
@@ -293,6 +324,12 @@ void Driver::draw_string(int16_t x, int16_t y, uint8_t col, const char* text) {
     }
 }
 
+void Driver::draw_char_batch(const CharCell *cells, int count) {
+    for (int i = 0; i < count; i++) {
+        draw_char(cells[i].x, cells[i].y, cells[i].col, cells[i].chr);
+    }
+}
+
 void Driver::clrscr(void) {
 	// TOO: de-hardcode
     for (int16_t y = 0; y < 25; y++) {
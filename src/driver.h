@@ -10,6 +10,7 @@
 namespace ZZT {
 	class Game;
 	class UserInterface;
+	class SessionRecorder;
 
     typedef enum {
         IMYield,
@@ -95,6 +96,23 @@ namespace ZZT {
         void set(uint8_t x, uint8_t y, uint8_t col, uint8_t chr);
     };
 
+    struct CharCell {
+        uint8_t x, y;
+        uint8_t col, chr;
+    };
+
+    // Input as seen by the game after update_input().
+    struct InputState {
+        int16_t deltaX, deltaY;
+        uint16_t keyPressed;
+        bool shiftPressed;
+        bool shiftAccepted;
+        bool joystickEnabled;
+        uint16_t key_modifiers;
+        uint32_t joy_buttons_pressed;
+        uint32_t joy_buttons_held;
+    };
+
     struct KeyPress {
         uint16_t value;
         uint16_t hsecs;
@@ -160,6 +178,16 @@ namespace ZZT {
         bool joy_button_pressed(JoyButton button, bool simulate);
         bool joy_button_held(JoyButton button, bool simulate);
 
+        void get_input_state(InputState &state) const;
+        void set_input_state(const InputState &state);
+
+        // if set, logs every input update and game timer read (see replay.h)
+        SessionRecorder *recorder;
+
+        // optional; called at the end of every completed game tick, after
+        // the recorder has logged it
+        virtual void on_game_tick(Game &game) { }
+
         /* SOUND/TIMER */
 
         // required
@@ -172,9 +200,7 @@ namespace ZZT {
         virtual void sound_lock(void) { };
         virtual void sound_unlock(void) { };
         virtual void sound_queue(int16_t priority, const uint8_t *pattern, int len) {
-            sound_lock();
             _queue.queue(priority, pattern, len);
-            sound_unlock();
         }
 
         void sound_clear_queue(void);
@@ -197,6 +223,7 @@ namespace ZZT {
 
         // optional
         virtual void draw_string(int16_t x, int16_t y, uint8_t col, const char* text);
+        virtual void draw_char_batch(const CharCell *cells, int count);
         virtual void clrscr(void);
         virtual void set_cursor(bool value);
         virtual void set_border_color(uint8_t value);
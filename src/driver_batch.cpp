@@ -0,0 +1,297 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <thread>
+#include <vector>
+#include "driver_batch.h"
+#include "filesystem_posix.h"
+#include "user_interface_super_zzt.h"
+#include "gamevars.h"
+
+using namespace ZZT;
+
+// A game stuck in a window or prompt for this many input updates per
+// allotted tick is stopped.
+#define BATCH_INPUTS_PER_TICK 64
+// A game which is still running this many input updates after being
+// stopped is hung; the batch gives up rather than wait for it.
+#define BATCH_INPUTS_AFTER_STOP 65536
+
+BatchDriver::BatchDriver(Game *game, uint32_t seed, int width_chars, int height_chars) {
+    this->game = game;
+    this->width_chars = width_chars;
+    this->height_chars = height_chars;
+
+    screen_buffer = (uint8_t*) malloc(width_chars * height_chars * 2);
+    memset(screen_buffer, 0, width_chars * height_chars * 2);
+    hsecs = 0;
+
+    this->seed = seed;
+    bot.SetSeed(seed);
+    bot_key = 0;
+    bot_hold = 0;
+    tick_count = 0;
+    input_count = 0;
+    stop_input_count = 0;
+    stopped = false;
+
+    max_ticks = 0;
+    max_inputs = 0;
+    stalled = false;
+}
+
+BatchDriver::~BatchDriver() {
+    free(screen_buffer);
+}
+
+void BatchDriver::stop(void) {
+    game->gamePlayExitRequested = true;
+    game->gameTitleExitRequested = true;
+    game->gameStopRequested = true;
+    stopped = true;
+}
+
+void BatchDriver::on_game_tick(Game &game) {
+    if (++tick_count >= max_ticks || stalled) {
+        stop();
+    }
+}
+
+void BatchDriver::update_input(void) {
+    static const uint16_t bot_moves[4] = {KeyUp, KeyDown, KeyLeft, KeyRight};
+
+    if (max_inputs > 0 && ++input_count > max_inputs && !stalled) {
+        stalled = true;
+        stop();
+    }
+
+    if (stopped && ++stop_input_count > BATCH_INPUTS_AFTER_STOP) {
+        // There is no way to unwind the game from here.
+        fprintf(stderr, "[driver_batch] instance with seed %u did not stop, aborting the batch\n", seed);
+        fflush(stderr);
+        _Exit(1);
+    }
+
+    if (stalled) {
+        // back out of whatever is holding the game up
+        set_key_pressed(KeyEscape, true, true);
+    } else if (game->gameStateElement == EMonitor) {
+        set_key_pressed('P', true, true);
+    } else {
+        if (--bot_hold <= 0) {
+            // Mostly walk and shoot around, holding each direction for a
+            // few updates; now and then confirm a window or light a torch.
+            int16_t action = bot.Next(100);
+            set_key_modifier_state(KeyModShift, action >= 75 && action < 95);
+            if (action < 95) {
+                bot_key = bot_moves[bot.Next(4)];
+                bot_hold = 1 + bot.Next(8);
+            } else {
+                bot_key = action < 98 ? KeyEnter : 'T';
+                bot_hold = 1;
+            }
+        }
+        set_key_pressed(bot_key, true, true);
+    }
+
+    advance_input();
+}
+
+uint16_t BatchDriver::get_hsecs(void) {
+    return hsecs++;
+}
+
+void BatchDriver::delay(int ms) {
+    hsecs += ms / 10;
+}
+
+void BatchDriver::idle(IdleMode mode) {
+    // Batch runs are unthrottled.
+}
+
+void BatchDriver::sound_stop(void) {
+
+}
+
+void BatchDriver::draw_char(int16_t x, int16_t y, uint8_t col, uint8_t chr) {
+    int offset = (y * width_chars + x) << 1;
+    screen_buffer[offset] = chr;
+    screen_buffer[offset + 1] = col;
+}
+
+void BatchDriver::read_char(int16_t x, int16_t y, uint8_t &col, uint8_t &chr) {
+    int offset = (y * width_chars + x) << 1;
+    chr = screen_buffer[offset];
+    col = screen_buffer[offset + 1];
+}
+
+UserInterface *BatchDriver::create_user_interface(Game &game, bool is_editor) {
+	if (game.engineDefinition.engineType == ENGINE_TYPE_SUPER_ZZT && !is_editor) {
+		return new UserInterfaceSuperZZT(this, 40, 25);
+	} else {
+		return new UserInterface(this);
+	}
+}
+
+struct BatchOptions {
+    const char *world_name;
+    uint32_t instances;
+    uint32_t threads;
+    uint32_t ticks;
+    uint32_t seed;
+    const char *session_pattern; // printf-style, given the instance's seed
+};
+
+struct BatchResult {
+    uint32_t seed;
+    uint32_t ticks;
+    uint32_t hash;
+    int16_t score;
+    int16_t health;
+    int16_t board;
+    bool stalled;
+};
+
+static uint64_t batch_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t) ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
+}
+
+static void batch_run_instance(const BatchOptions &options, BatchResult &result) {
+    Game *game = new Game();
+    BatchDriver driver = BatchDriver(game, result.seed, 80, 25);
+    driver.max_ticks = options.ticks;
+    driver.max_inputs = options.ticks * BATCH_INPUTS_PER_TICK;
+
+    game->driver = &driver;
+    // Instances share the directory; keep them from writing saves or high scores.
+    game->filesystem = new PosixFilesystemDriver(true);
+    game->random.SetSeed(result.seed);
+    game->tickSpeed = 0;
+
+    if (options.world_name != nullptr) {
+        // WorldLoad appends the extension itself.
+        StrCopy(game->startupWorldFileName, options.world_name);
+        int len = StrLength(game->startupWorldFileName);
+        if (len > 4 && game->startupWorldFileName[len - 4] == '.') {
+            game->startupWorldFileName[len - 4] = 0;
+        }
+    }
+
+    SessionRecorder recorder;
+    if (options.session_pattern != nullptr) {
+        char filename[1024];
+        snprintf(filename, sizeof(filename), options.session_pattern, result.seed);
+        if (recorder.open(filename, *game)) {
+            driver.recorder = &recorder;
+        } else {
+            fprintf(stderr, "[driver_batch] could not open session recording %s\n", filename);
+        }
+    }
+
+    game->GameTitleLoop();
+    recorder.close();
+
+    result.ticks = driver.ticks();
+    result.hash = SessionStateHash(*game);
+    result.score = game->world.info.score;
+    result.health = game->world.info.health;
+    result.board = game->world.info.current_board;
+    result.stalled = driver.stalled;
+
+    delete game->filesystem;
+    delete game;
+}
+
+static void print_usage(const char *name) {
+    fprintf(stderr, "Usage: %s [options] [world]\n", name);
+    fprintf(stderr, "  -n <count>    number of game instances to run (default 100)\n");
+    fprintf(stderr, "  -j <threads>  worker threads (default: one per core)\n");
+    fprintf(stderr, "  -t <ticks>    game ticks per instance (default 1000)\n");
+    fprintf(stderr, "  -s <seed>     seed of the first instance; instance i uses seed + i (default 1)\n");
+    fprintf(stderr, "  -l <pattern>  record each session (for openzoo-replay), to a filename\n");
+    fprintf(stderr, "                pattern given the instance's seed, such as seed%%u.txt\n");
+}
+
+int main(int argc, char** argv) {
+	BatchOptions options = {
+		.world_name = nullptr,
+		.instances = 100,
+		.threads = std::thread::hardware_concurrency(),
+		.ticks = 1000,
+		.seed = 1,
+		.session_pattern = nullptr
+	};
+
+	for (int i = 1; i < argc; i++) {
+		if (argv[i][0] == '-' && argv[i][1] != 0 && argv[i][2] == 0) {
+			char opt = argv[i][1];
+			if ((i + 1) < argc) {
+				const char *value = argv[++i];
+				switch (opt) {
+				case 'n': options.instances = strtoul(value, nullptr, 10); continue;
+				case 'j': options.threads = strtoul(value, nullptr, 10); continue;
+				case 't': options.ticks = strtoul(value, nullptr, 10); continue;
+				case 's': options.seed = strtoul(value, nullptr, 10); continue;
+				case 'l': options.session_pattern = value; continue;
+				}
+			}
+			print_usage(argv[0]);
+			return 1;
+		} else if (options.world_name == nullptr) {
+			options.world_name = argv[i];
+		} else {
+			print_usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (options.threads == 0) {
+		options.threads = 1;
+	}
+	if (options.threads > options.instances) {
+		options.threads = options.instances;
+	}
+
+	std::vector<BatchResult> results(options.instances);
+	for (uint32_t i = 0; i < options.instances; i++) {
+		results[i].seed = options.seed + i;
+	}
+
+	std::atomic<uint32_t> next_instance(0);
+	uint64_t start_us = batch_now_us();
+
+	std::vector<std::thread> workers;
+	for (uint32_t i = 0; i < options.threads; i++) {
+		workers.emplace_back([&options, &results, &next_instance]() {
+			uint32_t index;
+			while ((index = next_instance++) < options.instances) {
+				batch_run_instance(options, results[index]);
+			}
+		});
+	}
+	for (std::thread &worker : workers) {
+		worker.join();
+	}
+
+	uint64_t elapsed_us = batch_now_us() - start_us;
+	uint64_t total_ticks = 0;
+	uint32_t stalled = 0;
+
+	printf("# seed ticks hash score health board\n");
+	for (BatchResult &result : results) {
+		printf("%u %u %08X %d %d %d%s\n", result.seed, result.ticks, result.hash,
+			result.score, result.health, result.board, result.stalled ? " stalled" : "");
+		total_ticks += result.ticks;
+		if (result.stalled) stalled++;
+	}
+
+	fprintf(stderr, "[driver_batch] ran %u instances (%u stalled), %llu ticks in %u ms on %u threads (%llu ticks/s)\n",
+		options.instances, stalled, (unsigned long long) total_ticks, (uint32_t) (elapsed_us / 1000), options.threads,
+		(unsigned long long) (elapsed_us > 0 ? (total_ticks * 1000000 / elapsed_us) : 0));
+	return 0;
+}
@@ -0,0 +1,65 @@
+#ifndef __DRIVER_BATCH_H__
+#define __DRIVER_BATCH_H__
+
+#include <cstdint>
+#include "driver.h"
+#include "replay.h"
+#include "utils/mathutils.h"
+
+namespace ZZT {
+    // Headless driver for one Game instance of a batch run. Time is virtual
+    // and input comes from a seeded bot, so every instance is deterministic
+    // given its seed.
+    class BatchDriver: public Driver {
+    private:
+        Game *game;
+        int width_chars, height_chars;
+        uint8_t *screen_buffer;
+        uint16_t hsecs;
+
+        uint32_t seed;
+        Random bot;
+        uint16_t bot_key;
+        int16_t bot_hold;
+        uint32_t tick_count;
+        uint32_t input_count;
+        uint32_t stop_input_count;
+        bool stopped;
+
+        void stop(void);
+
+    public:
+        // configuration, set before running the game
+        uint32_t max_ticks;
+        uint32_t max_inputs; // 0 = no limit
+
+        // outcome
+        bool stalled; // stopped by max_inputs
+
+        BatchDriver(Game *game, uint32_t seed, int width_chars, int height_chars);
+        ~BatchDriver();
+
+        inline uint32_t ticks(void) const { return tick_count; }
+
+        // ends the session once it has run max_ticks game ticks
+        void on_game_tick(Game &game) override;
+
+        // required (input)
+        void update_input(void) override;
+
+        // required (sound)
+        uint16_t get_hsecs(void) override;
+        void delay(int ms) override;
+        void idle(IdleMode mode) override;
+        void sound_stop(void) override;
+
+        // required (video)
+        void draw_char(int16_t x, int16_t y, uint8_t col, uint8_t chr) override;
+        void read_char(int16_t x, int16_t y, uint8_t &col, uint8_t &chr) override;
+
+        // optional
+        UserInterface *create_user_interface(Game &game, bool is_editor) override;
+    };
+}
+
+#endif
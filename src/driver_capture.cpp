@@ -0,0 +1,496 @@
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "driver_capture.h"
+#include "filesystem_posix.h"
+#include "replay.h"
+#include "user_interface_super_zzt.h"
+#include "gamevars.h"
+#include "8x14_bin.h"
+
+#define PIT_SPEED_MS 55
+#define TEXT_BLINK_RATE 534
+
+static const uint32_t ega_palette[16] = {
+    0x000000,
+    0x0000AA,
+    0x00AA00,
+    0x00AAAA,
+    0xAA0000,
+    0xAA00AA,
+    0xAA5500,
+    0xAAAAAA,
+    0x555555,
+    0x5555FF,
+    0x55FF55,
+    0x55FFFF,
+    0xFF5555,
+    0xFF55FF,
+    0xFFFF55,
+    0xFFFFFF
+};
+
+using namespace ZZT;
+
+/* PNG writer - stored (uncompressed) deflate blocks, no external dependencies */
+
+static uint32_t png_crc_table[256];
+
+static void png_crc_init(void) {
+    for (uint32_t n = 0; n < 256; n++) {
+        uint32_t c = n;
+        for (int k = 0; k < 8; k++) {
+            c = (c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1);
+        }
+        png_crc_table[n] = c;
+    }
+}
+
+static uint32_t png_crc(uint32_t crc, const uint8_t *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        crc = png_crc_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+static void png_write_u32(FILE *file, uint32_t value) {
+    uint8_t buf[4] = {(uint8_t) (value >> 24), (uint8_t) (value >> 16), (uint8_t) (value >> 8), (uint8_t) value};
+    fwrite(buf, 1, 4, file);
+}
+
+class PNGChunkWriter {
+private:
+    FILE *file;
+    uint32_t crc;
+
+public:
+    PNGChunkWriter(FILE *file, const char *type, uint32_t len) {
+        this->file = file;
+        png_write_u32(file, len);
+        write((const uint8_t*) type, 4);
+        crc = png_crc(0xFFFFFFFF, (const uint8_t*) type, 4);
+    }
+
+    void write(const uint8_t *data, size_t len) {
+        fwrite(data, 1, len, file);
+        crc = png_crc(crc, data, len);
+    }
+
+    ~PNGChunkWriter() {
+        png_write_u32(file, crc ^ 0xFFFFFFFF);
+    }
+};
+
+static bool png_write(const char *filename, const uint8_t *rgb, int width, int height) {
+    FILE *file = fopen(filename, "wb");
+    if (file == nullptr) return false;
+
+    static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    fwrite(signature, 1, 8, file);
+
+    {
+        uint8_t ihdr[13] = {
+            (uint8_t) (width >> 24), (uint8_t) (width >> 16), (uint8_t) (width >> 8), (uint8_t) width,
+            (uint8_t) (height >> 24), (uint8_t) (height >> 16), (uint8_t) (height >> 8), (uint8_t) height,
+            8, 2, 0, 0, 0 // 8-bit RGB
+        };
+        PNGChunkWriter chunk(file, "IHDR", 13);
+        chunk.write(ihdr, 13);
+    }
+
+    // each scanline is preceded by a filter type byte (0 = none)
+    uint32_t row_len = width * 3 + 1;
+    uint32_t raw_len = row_len * height;
+    uint32_t block_count = (raw_len + 65534) / 65535;
+    {
+        PNGChunkWriter chunk(file, "IDAT", 2 + block_count * 5 + raw_len + 4);
+        static const uint8_t zlib_header[2] = {0x78, 0x01};
+        chunk.write(zlib_header, 2);
+
+        uint32_t adler_a = 1, adler_b = 0;
+        uint32_t block_left = 0;
+        uint32_t raw_left = raw_len;
+        for (int y = 0; y < height; y++) {
+            for (uint32_t x = 0; x < row_len; ) {
+                if (block_left == 0) {
+                    block_left = raw_left > 65535 ? 65535 : raw_left;
+                    uint8_t block_header[5] = {
+                        (uint8_t) (raw_left == block_left ? 1 : 0),
+                        (uint8_t) block_left, (uint8_t) (block_left >> 8),
+                        (uint8_t) ~block_left, (uint8_t) (~block_left >> 8)
+                    };
+                    chunk.write(block_header, 5);
+                }
+
+                const uint8_t filter_none = 0;
+                const uint8_t *data = x == 0 ? &filter_none : (rgb + (y * width * 3) + x - 1);
+                uint32_t len = x == 0 ? 1 : (row_len - x);
+                if (len > block_left) len = block_left;
+
+                chunk.write(data, len);
+                for (uint32_t i = 0; i < len; i++) {
+                    adler_a = (adler_a + data[i]) % 65521;
+                    adler_b = (adler_b + adler_a) % 65521;
+                }
+
+                x += len;
+                block_left -= len;
+                raw_left -= len;
+            }
+        }
+
+        uint8_t adler[4] = {(uint8_t) (adler_b >> 8), (uint8_t) adler_b, (uint8_t) (adler_a >> 8), (uint8_t) adler_a};
+        chunk.write(adler, 4);
+    }
+
+    {
+        PNGChunkWriter chunk(file, "IEND", 0);
+    }
+
+    bool result = !ferror(file);
+    fclose(file);
+    return result;
+}
+
+/* CaptureDriver */
+
+CaptureDriver::CaptureDriver(int width_chars, int height_chars, Charset &charset) {
+    this->width_chars = width_chars;
+    this->height_chars = height_chars;
+    this->char_width = charset.width();
+    this->char_height = charset.height();
+    this->video_doubleWide = false;
+
+    screen_buffer = (uint8_t*) malloc(width_chars * height_chars * 2);
+    memset(screen_buffer, 0, width_chars * height_chars * 2);
+
+    // Expand the charset into one byte per pixel, so that rendering a frame
+    // does not need to walk the packed glyph data.
+    glyphs = (uint8_t*) malloc(256 * char_width * char_height);
+    memset(glyphs, 0, 256 * char_width * char_height);
+    Charset::Iterator charsetIterator = charset.iterate();
+    while (charsetIterator.next()) {
+        if (charsetIterator.glyph < 256) {
+            glyphs[(charsetIterator.glyph * char_height + charsetIterator.y) * char_width + charsetIterator.x] = charsetIterator.value != 0;
+        }
+    }
+
+    frame = nullptr;
+    pit_ticks = 0;
+    last_tick_pit_ticks = 0;
+    delay_ms = 0;
+    frames_written = 0;
+    key_script = nullptr;
+    stopped = false;
+    raw_output = nullptr;
+    raw_output_piped = false;
+    sound_recording = nullptr;
+    sound_output = nullptr;
+
+    game = nullptr;
+    format = CaptureFormatPNG;
+    output = "frame%05d.png";
+    stride = 1;
+    max_frames = 0;
+    key_interval = 9;
+}
+
+CaptureDriver::~CaptureDriver() {
+    uninstall();
+    free(glyphs);
+    free(screen_buffer);
+}
+
+void CaptureDriver::install(void) {
+    png_crc_init();
+    frame = (uint8_t*) malloc(frame_width() * frame_height() * 3);
+
+    if (format == CaptureFormatRaw) {
+        if (!strcmp(output, "-")) {
+            raw_output = stdout;
+        } else if (output[0] == '|') {
+            raw_output = popen(output + 1, "w");
+            raw_output_piped = true;
+        } else {
+            raw_output = fopen(output, "wb");
+        }
+
+        if (raw_output == nullptr) {
+            fprintf(stderr, "[driver_capture] could not open output %s\n", output);
+            exit(1);
+        }
+    }
+
+    if (sound_output != nullptr) {
+        sound_recording = fopen(sound_output, "w");
+        if (sound_recording == nullptr) {
+            fprintf(stderr, "[driver_capture] could not open sound recording %s\n", sound_output);
+            exit(1);
+        }
+    }
+
+    fprintf(stderr, "[driver_capture] capturing %dx%d frames, every %d PIT ticks\n",
+        frame_width(), frame_height(), stride);
+}
+
+void CaptureDriver::uninstall(void) {
+    if (sound_recording != nullptr) {
+        fclose(sound_recording);
+        sound_recording = nullptr;
+    }
+
+    if (raw_output != nullptr) {
+        if (raw_output_piped) {
+            pclose(raw_output);
+        } else if (raw_output != stdout) {
+            fclose(raw_output);
+        } else {
+            fflush(raw_output);
+        }
+        raw_output = nullptr;
+    }
+
+    if (frame != nullptr) {
+        free(frame);
+        frame = nullptr;
+    }
+}
+
+void CaptureDriver::render_frame(void) {
+    int cell_width = char_width * (video_doubleWide ? 2 : 1);
+    int chars_visible = video_doubleWide ? (width_chars >> 1) : width_chars;
+    bool blink_visible = ((pit_ticks * PIT_SPEED_MS / TEXT_BLINK_RATE) & 1) == 0;
+    int pitch = frame_width() * 3;
+
+    if (video_doubleWide) {
+        memset(frame, 0, pitch * frame_height());
+    }
+
+    for (int cy = 0; cy < height_chars; cy++) {
+        for (int cx = 0; cx < chars_visible; cx++) {
+            int offset = (cy * width_chars + cx) << 1;
+            uint8_t chr = screen_buffer[offset];
+            uint8_t col = screen_buffer[offset + 1];
+            uint32_t bg_col = ega_palette[(col >> 4) & 0x07];
+            uint32_t fg_col = ega_palette[col & 0x0F];
+            if (col >= 0x80 && !blink_visible) fg_col = bg_col;
+
+            const uint8_t *glyph = glyphs + (chr * char_height * char_width);
+            uint8_t *row = frame + (cy * char_height * pitch) + (cx * cell_width * 3);
+            for (int py = 0; py < char_height; py++, row += pitch, glyph += char_width) {
+                uint8_t *pixel = row;
+                for (int px = 0; px < cell_width; px++) {
+                    uint32_t rgb = glyph[video_doubleWide ? (px >> 1) : px] ? fg_col : bg_col;
+                    *(pixel++) = rgb >> 16;
+                    *(pixel++) = rgb >> 8;
+                    *(pixel++) = rgb;
+                }
+            }
+        }
+    }
+}
+
+bool CaptureDriver::write_frame(void) {
+    render_frame();
+
+    if (format == CaptureFormatRaw) {
+        size_t len = frame_width() * frame_height() * 3;
+        return fwrite(frame, 1, len, raw_output) == len;
+    } else {
+        char filename[1024];
+        snprintf(filename, sizeof(filename), output, frames_written);
+        return png_write(filename, frame, frame_width(), frame_height());
+    }
+}
+
+void CaptureDriver::on_game_tick(Game &game) {
+    if (pit_ticks == last_tick_pit_ticks) {
+        advance_pit();
+    }
+    last_tick_pit_ticks = pit_ticks;
+}
+
+void CaptureDriver::stop(void) {
+    stopped = true;
+    game->gamePlayExitRequested = true;
+    game->gameTitleExitRequested = true;
+    game->gameStopRequested = true;
+}
+
+void CaptureDriver::advance_pit(void) {
+    pit_ticks++;
+    if (stopped) return;
+
+    if (key_script != nullptr && (pit_ticks % key_interval) == 0) {
+        if (*key_script != 0) {
+            set_key_pressed((uint8_t) *(key_script++), true, true);
+        } else {
+            key_script = nullptr;
+        }
+    }
+
+    if ((pit_ticks % stride) == 0) {
+        if (!write_frame()) {
+            fprintf(stderr, "[driver_capture] could not write frame %d\n", frames_written);
+            exit(1);
+        }
+        frames_written++;
+
+        if (max_frames > 0 && frames_written >= max_frames) {
+            stop();
+        }
+    }
+}
+
+void CaptureDriver::update_input(void) {
+    if (stopped) {
+        // back out of whatever window or prompt is open
+        set_key_pressed(KeyEscape, true, true);
+    }
+    advance_input();
+}
+
+uint16_t CaptureDriver::get_hsecs(void) {
+    return (pit_ticks * (PIT_SPEED_MS / 5)) >> 1;
+}
+
+void CaptureDriver::delay(int ms) {
+    delay_ms += ms;
+    while (delay_ms >= PIT_SPEED_MS) {
+        delay_ms -= PIT_SPEED_MS;
+        advance_pit();
+    }
+}
+
+void CaptureDriver::idle(IdleMode mode) {
+    // There is no display to wait for; frames are paced by the PIT.
+    if (mode != IMYield) {
+        advance_pit();
+    }
+}
+
+void CaptureDriver::sound_stop(void) {
+    if (sound_recording != nullptr) {
+        fprintf(sound_recording, "%u C\n", pit_ticks);
+    }
+}
+
+void CaptureDriver::sound_queue(int16_t priority, const uint8_t *pattern, int len) {
+    if (sound_recording != nullptr) {
+        fprintf(sound_recording, "%u Q %d ", pit_ticks, priority);
+        for (int i = 0; i < len; i++) {
+            fprintf(sound_recording, "%02X", pattern[i]);
+        }
+        fputc('\n', sound_recording);
+    }
+    Driver::sound_queue(priority, pattern, len);
+}
+
+void CaptureDriver::draw_char(int16_t x, int16_t y, uint8_t col, uint8_t chr) {
+    int offset = (y * width_chars + x) << 1;
+    screen_buffer[offset] = chr;
+    screen_buffer[offset + 1] = col;
+}
+
+void CaptureDriver::read_char(int16_t x, int16_t y, uint8_t &col, uint8_t &chr) {
+    int offset = (y * width_chars + x) << 1;
+    chr = screen_buffer[offset];
+    col = screen_buffer[offset + 1];
+}
+
+UserInterface *CaptureDriver::create_user_interface(Game &game, bool is_editor) {
+	if (game.engineDefinition.engineType == ENGINE_TYPE_SUPER_ZZT && !is_editor) {
+		video_doubleWide = true;
+		return new UserInterfaceSuperZZT(this, 40, 25);
+	} else {
+		video_doubleWide = false;
+		return new UserInterface(this);
+	}
+}
+
+static void print_usage(const char *name) {
+    fprintf(stderr, "Usage: %s [options] [world]\n", name);
+    fprintf(stderr, "  -o <output>   PNG filename pattern (default frame%%05d.png);\n");
+    fprintf(stderr, "                with -r, a file, '-' for stdout or '|command'\n");
+    fprintf(stderr, "  -r            write raw RGB24 frames instead of PNG files\n");
+    fprintf(stderr, "  -s <ticks>    capture a frame every <ticks> PIT ticks (default 1)\n");
+    fprintf(stderr, "  -n <frames>   exit after <frames> frames (default 0 = never)\n");
+    fprintf(stderr, "  -k <keys>     keys to press, one every 9 PIT ticks (default: Escape)\n");
+    fprintf(stderr, "  -a <file>     record sound_queue calls (for openzoo-audio-render)\n");
+    fprintf(stderr, "  -l <file>     record the session (for openzoo-replay)\n");
+}
+
+int main(int argc, char** argv) {
+	Charset charset = Charset(256, 8, 14, 1, _8x14_bin);
+	CaptureDriver driver = CaptureDriver(80, 25, charset);
+	const char *world_name = nullptr;
+	const char *session_name = nullptr;
+	// Dismiss the startup about screen by default.
+	driver.set_key_script("\x1b");
+
+	for (int i = 1; i < argc; i++) {
+		if (argv[i][0] == '-' && argv[i][1] != 0 && argv[i][2] == 0) {
+			char opt = argv[i][1];
+			if (opt == 'r') {
+				driver.format = CaptureFormatRaw;
+				continue;
+			} else if ((i + 1) < argc) {
+				const char *value = argv[++i];
+				switch (opt) {
+				case 'o': driver.output = value; continue;
+				case 's': driver.stride = atoi(value) > 0 ? atoi(value) : 1; continue;
+				case 'n': driver.max_frames = atoi(value); continue;
+				case 'k': driver.set_key_script(value); continue;
+				case 'a': driver.sound_output = value; continue;
+				case 'l': session_name = value; continue;
+				}
+			}
+			print_usage(argv[0]);
+			return 1;
+		} else if (world_name == nullptr) {
+			world_name = argv[i];
+		} else {
+			print_usage(argv[0]);
+			return 1;
+		}
+	}
+
+	Game *game = new Game();
+
+	game->driver = &driver;
+	game->filesystem = new PosixFilesystemDriver();
+
+	if (world_name != nullptr) {
+		// WorldLoad appends the extension itself.
+		StrCopy(game->startupWorldFileName, world_name);
+		int len = StrLength(game->startupWorldFileName);
+		if (len > 4 && game->startupWorldFileName[len - 4] == '.') {
+			game->startupWorldFileName[len - 4] = 0;
+		}
+	}
+
+	driver.game = game;
+	SessionRecorder recorder;
+	if (session_name != nullptr) {
+		if (!recorder.open(session_name, *game)) {
+			fprintf(stderr, "[driver_capture] could not open session recording %s\n", session_name);
+			return 1;
+		}
+		driver.recorder = &recorder;
+	}
+
+	driver.install();
+
+	driver.clrscr();
+
+	game->GameTitleLoop();
+
+	driver.uninstall();
+	recorder.close();
+
+	delete game->filesystem;
+	delete game;
+
+	return 0;
+}
@@ -0,0 +1,86 @@
+#ifndef __DRIVER_CAPTURE_H__
+#define __DRIVER_CAPTURE_H__
+
+#include <cstdint>
+#include <cstdio>
+#include "assets.h"
+#include "driver.h"
+
+namespace ZZT {
+    typedef enum {
+        CaptureFormatPNG,
+        CaptureFormatRaw
+    } CaptureFormat;
+
+    // Headless driver which renders the text screen to RGB24 frames on a
+    // virtual PIT clock, writing them out as a PNG sequence or raw video.
+    class CaptureDriver: public Driver {
+    private:
+        int width_chars, height_chars;
+        uint8_t *screen_buffer;
+        uint8_t *glyphs;
+        uint8_t *frame;
+        int char_width, char_height;
+        bool video_doubleWide;
+
+        uint32_t pit_ticks;
+        uint32_t last_tick_pit_ticks; // as of the previous game tick
+        uint32_t delay_ms;
+        uint32_t frames_written;
+        const char *key_script;
+        bool stopped;
+
+        FILE *raw_output;
+        bool raw_output_piped;
+        FILE *sound_recording;
+
+        void advance_pit(void);
+        void stop(void);
+        void render_frame(void);
+        bool write_frame(void);
+
+    public:
+        // configuration, set before install()
+        Game *game;
+        CaptureFormat format;
+        const char *output; // printf-style pattern (PNG), file path, "-" or "|command" (raw)
+        uint32_t stride; // PIT ticks per captured frame
+        uint32_t max_frames; // 0 = unlimited
+        uint32_t key_interval; // PIT ticks between scripted keypresses
+        const char *sound_output; // sound_queue() recording, see audio_render.cpp
+
+        CaptureDriver(int width_chars, int height_chars, Charset &charset);
+        ~CaptureDriver();
+
+        void install(void);
+        void uninstall(void);
+
+        int frame_width(void) const { return width_chars * char_width; }
+        int frame_height(void) const { return height_chars * char_height; }
+        void set_key_script(const char *keys) { key_script = keys; }
+
+        // advances the clock on game ticks which did not wait for the PIT
+        // (game speed 0 and fast-forward)
+        void on_game_tick(Game &game) override;
+
+        // required (input)
+        void update_input(void) override;
+
+        // required (sound)
+        uint16_t get_hsecs(void) override;
+        void delay(int ms) override;
+        void idle(IdleMode mode) override;
+        void sound_stop(void) override;
+        void sound_queue(int16_t priority, const uint8_t *pattern, int len) override;
+        using Driver::sound_queue;
+
+        // required (video)
+        void draw_char(int16_t x, int16_t y, uint8_t col, uint8_t chr) override;
+        void read_char(int16_t x, int16_t y, uint8_t &col, uint8_t &chr) override;
+
+        // optional
+        UserInterface *create_user_interface(Game &game, bool is_editor) override;
+    };
+}
+
+#endif
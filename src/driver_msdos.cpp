@@ -19,15 +19,13 @@ void ZZT::timerCallback(void) {
 	driver->hsecs += 11;
 
 	if (!driver->_queue.enabled) {
-		driver->_queue.is_playing = false;
+		driver->_queue.discard();
 		nosound();
-	} else if (driver->_queue.is_playing) {
+	} else if (driver->_queue.is_playing()) {
 		if ((--driver->duration_counter) <= 0) {
 			nosound();
 			uint16_t note, duration;
-			if (!driver->_queue.pop(note, duration)) {
-				driver->_queue.is_playing = false;
-			} else {
+			if (driver->_queue.pop(note, duration)) {
 				if (note >= NOTE_MIN && note < NOTE_MAX) {
 					sound(sound_notes[note - NOTE_MIN]);
 				} else if (note >= DRUM_MIN && note < DRUM_MAX) {
@@ -182,11 +180,9 @@ UserInterface *MSDOSDriver::create_user_interface(Game &game, bool is_editor) {
 
 #include "gamevars.h"
 
-static Game *game;
-
 int main(int argc, char** argv) {
 	MSDOSDriver driver = MSDOSDriver();
-	game = new Game();
+	Game *game = new Game();
 	
 	game->driver = &driver;
     game->filesystem = new MsdosFilesystemDriver();
@@ -47,11 +47,9 @@ void NullDriver::read_char(int16_t x, int16_t y, uint8_t &col, uint8_t &chr) {
 
 #include "gamevars.h"
 
-static Game *game;
-
 int main(int argc, char** argv) {
 	NullDriver driver = NullDriver();
-	game = new Game();
+	Game *game = new Game();
 	
 	game->driver = &driver;
 	game->filesystem = new NullFilesystemDriver();
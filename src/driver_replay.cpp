@@ -0,0 +1,241 @@
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include "driver_replay.h"
+#include "filesystem_posix.h"
+#include "trace.h"
+#include "user_interface_super_zzt.h"
+#include "gamevars.h"
+
+using namespace ZZT;
+
+void ReplayChecker::record_world(Game &game, const char *name) {
+    SessionRecorder::record_world(game, name);
+    driver->expect(SessionRecordWorld, "a world load");
+
+    uint32_t hash = SessionStateHash(game);
+    if (hash != driver->reader.hash) {
+        fprintf(stderr, "[driver_replay] line %u: world %s has hash %08X, recording has %08X\n",
+            driver->reader.line(), name, hash, driver->reader.hash);
+        exit(1);
+    }
+    driver->reader.next();
+}
+
+void ReplayChecker::record_tick(Game &game) {
+    SessionRecorder::record_tick(game);
+    driver->expect(SessionRecordTick, "a game tick");
+
+    uint32_t hash = SessionStateHash(game);
+    if (tick_count != driver->reader.tick || hash != driver->reader.hash) {
+        fprintf(stderr, "[driver_replay] line %u: tick %u has state hash %08X, recording has tick %u, %08X\n",
+            driver->reader.line(), tick_count, hash, driver->reader.tick, driver->reader.hash);
+        exit(1);
+    }
+    driver->reader.next();
+}
+
+ReplayDriver::ReplayDriver(int width_chars, int height_chars) {
+    this->width_chars = width_chars;
+    this->height_chars = height_chars;
+    this->video_doubleWide = false;
+
+    screen_buffer = (uint8_t*) malloc(width_chars * height_chars * 2);
+    memset(screen_buffer, 0, width_chars * height_chars * 2);
+
+    checker.driver = this;
+    game = nullptr;
+    input_count = 0;
+    start_us = 0;
+    trace_output = nullptr;
+    profile = false;
+}
+
+ReplayDriver::~ReplayDriver() {
+    uninstall();
+    free(screen_buffer);
+}
+
+bool ReplayDriver::open(const char *filename, Game &game) {
+    if (!reader.open(filename, game)) {
+        return false;
+    }
+    if (trace_output != nullptr && !checker.open(trace_output, game)) {
+        fprintf(stderr, "[driver_replay] could not open trace %s\n", trace_output);
+        exit(1);
+    }
+    recorder = &checker;
+    if (profile) {
+        game.profiler.start();
+    }
+    this->game = &game;
+    return true;
+}
+
+void ReplayDriver::install(void) {
+    start_us = now_us();
+}
+
+void ReplayDriver::uninstall(void) {
+    checker.close();
+}
+
+uint64_t ReplayDriver::now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t) ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
+}
+
+// The game must ask for exactly what the original run did next; anything
+// else means the replay has diverged.
+void ReplayDriver::expect(SessionRecordType type, const char *what) {
+    if (reader.type == type) {
+        return;
+    } else if (reader.type == SessionRecordNone && reader.at_end()) {
+        finish();
+    } else if (reader.type == SessionRecordNone) {
+        fprintf(stderr, "[driver_replay] line %u: could not parse record\n", reader.line());
+        exit(1);
+    } else {
+        fprintf(stderr, "[driver_replay] line %u: replay diverged, game reached %s\n", reader.line(), what);
+        exit(1);
+    }
+}
+
+void ReplayDriver::finish(void) {
+    if (reader.type != SessionRecordNone) {
+        fprintf(stderr, "[driver_replay] line %u: game exited before the end of the recording\n", reader.line());
+        exit(1);
+    }
+
+    uint64_t elapsed_us = now_us() - start_us;
+    fprintf(stderr, "[driver_replay] replayed %u ticks, %u inputs in %u ms (%u ticks/s)\n",
+        checker.ticks(), input_count, (uint32_t) (elapsed_us / 1000),
+        (uint32_t) (elapsed_us > 0 ? ((uint64_t) checker.ticks() * 1000000 / elapsed_us) : 0));
+    if (game != nullptr && game->profiler.has_data()) {
+        game->profiler.report(*game, [](const char *line) {
+            fprintf(stderr, "[driver_replay] profile: %s\n", line);
+        });
+    }
+    TraceStop();
+    uninstall();
+    exit(0);
+}
+
+void ReplayDriver::update_input(void) {
+    expect(SessionRecordInput, "an input update");
+    set_input_state(reader.input);
+    input_count++;
+    reader.next();
+}
+
+uint16_t ReplayDriver::get_hsecs(void) {
+    expect(SessionRecordHsecs, "a timer read");
+    uint16_t hsecs = reader.hsecs;
+    reader.next();
+    return hsecs;
+}
+
+void ReplayDriver::delay(int ms) {
+    // Replays run unthrottled.
+}
+
+void ReplayDriver::idle(IdleMode mode) {
+    // Replays run unthrottled.
+}
+
+void ReplayDriver::sound_stop(void) {
+
+}
+
+void ReplayDriver::draw_char(int16_t x, int16_t y, uint8_t col, uint8_t chr) {
+    int offset = (y * width_chars + x) << 1;
+    screen_buffer[offset] = chr;
+    screen_buffer[offset + 1] = col;
+}
+
+void ReplayDriver::read_char(int16_t x, int16_t y, uint8_t &col, uint8_t &chr) {
+    int offset = (y * width_chars + x) << 1;
+    chr = screen_buffer[offset];
+    col = screen_buffer[offset + 1];
+}
+
+// Must match the user interface of the recording driver, as prompts and
+// menus consume input.
+UserInterface *ReplayDriver::create_user_interface(Game &game, bool is_editor) {
+	if (game.engineDefinition.engineType == ENGINE_TYPE_SUPER_ZZT && !is_editor) {
+		video_doubleWide = true;
+		return new UserInterfaceSuperZZT(this, 40, 25);
+	} else {
+		video_doubleWide = false;
+		return new UserInterface(this);
+	}
+}
+
+static void print_usage(const char *name) {
+    fprintf(stderr, "Usage: %s [options] <recording>\n", name);
+    fprintf(stderr, "  -t <file>     write the replay's per-tick state hashes to <file>\n");
+    fprintf(stderr, "  -p            profile element ticks and objects, reporting at the end\n");
+    fprintf(stderr, "  -e <file>     write a trace-event timeline to <file> (tracing builds only)\n");
+}
+
+int main(int argc, char** argv) {
+	ReplayDriver driver = ReplayDriver(80, 25);
+	const char *recording_name = nullptr;
+	const char *trace_name = nullptr;
+
+	for (int i = 1; i < argc; i++) {
+		if (argv[i][0] == '-' && argv[i][1] != 0 && argv[i][2] == 0) {
+			char opt = argv[i][1];
+			if (opt == 'p') {
+				driver.profile = true;
+				continue;
+			} else if ((i + 1) < argc) {
+				const char *value = argv[++i];
+				switch (opt) {
+				case 't': driver.trace_output = value; continue;
+				case 'e': trace_name = value; continue;
+				}
+			}
+			print_usage(argv[0]);
+			return 1;
+		} else if (recording_name == nullptr) {
+			recording_name = argv[i];
+		} else {
+			print_usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (recording_name == nullptr) {
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	Game *game = new Game();
+
+	game->driver = &driver;
+	game->filesystem = new PosixFilesystemDriver();
+
+	if (!driver.open(recording_name, *game)) {
+		fprintf(stderr, "[driver_replay] could not read recording %s\n", recording_name);
+		return 1;
+	}
+
+	if (trace_name != nullptr && !TraceStart(trace_name)) {
+		fprintf(stderr, "[driver_replay] could not start trace %s\n", trace_name);
+		return 1;
+	}
+
+	driver.install();
+
+	driver.clrscr();
+
+	game->GameTitleLoop();
+
+	// Exits, reporting whether the recording ended here as well.
+	driver.finish();
+	return 1;
+}
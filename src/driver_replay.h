@@ -0,0 +1,78 @@
+#ifndef __DRIVER_REPLAY_H__
+#define __DRIVER_REPLAY_H__
+
+#include <cstdint>
+#include <cstdio>
+#include "driver.h"
+#include "replay.h"
+
+namespace ZZT {
+    class ReplayDriver;
+
+    // Checks the replayed game against the recording's world and tick hashes,
+    // optionally writing its own hashes out as a trace.
+    class ReplayChecker: public SessionRecorder {
+        friend ReplayDriver;
+
+    private:
+        ReplayDriver *driver;
+
+    public:
+        void record_input(const InputState &state) override { }
+        void record_hsecs(uint16_t hsecs) override { }
+        void record_world(Game &game, const char *name) override;
+        void record_tick(Game &game) override;
+    };
+
+    // Headless driver which plays back a session recording (see replay.h) as
+    // fast as possible, feeding the game the recorded input and timer values.
+    class ReplayDriver: public Driver {
+        friend ReplayChecker;
+
+    private:
+        int width_chars, height_chars;
+        uint8_t *screen_buffer;
+        bool video_doubleWide;
+
+        Game *game;
+        SessionReader reader;
+        ReplayChecker checker;
+        uint32_t input_count;
+        uint64_t start_us;
+
+        uint64_t now_us(void);
+        void expect(SessionRecordType type, const char *what);
+
+    public:
+        // configuration, set before open()
+        const char *trace_output; // per-tick state hashes, or nullptr
+        bool profile; // run the tick profiler, reporting at the end
+
+        ReplayDriver(int width_chars, int height_chars);
+        ~ReplayDriver();
+
+        bool open(const char *filename, Game &game);
+        void finish(void);
+
+        void install(void);
+        void uninstall(void);
+
+        // required (input)
+        void update_input(void) override;
+
+        // required (sound)
+        uint16_t get_hsecs(void) override;
+        void delay(int ms) override;
+        void idle(IdleMode mode) override;
+        void sound_stop(void) override;
+
+        // required (video)
+        void draw_char(int16_t x, int16_t y, uint8_t col, uint8_t chr) override;
+        void read_char(int16_t x, int16_t y, uint8_t &col, uint8_t &chr) override;
+
+        // optional
+        UserInterface *create_user_interface(Game &game, bool is_editor) override;
+    };
+}
+
+#endif
@@ -1,14 +1,22 @@
 #include <cstddef>
+#include <cstdlib>
 #include <cstring>
 #include <SDL.h>
 #include "driver.h"
 #include "driver_sdl2.h"
 #include "filesystem_posix.h"
+#include "replay.h"
+#include "trace.h"
 #include "user_interface_slim.h"
 #include "user_interface_super_zzt.h"
 #include "gamevars.h"
 
 #define PIT_SPEED_MS 55
+#define AUDIO_BUFFER_MIN 128
+#define AUDIO_BUFFER_MAX 8192
+#define AUDIO_BUFFER_DEFAULT 512
+// adaptive mode: time without underruns before halving the buffer
+#define AUDIO_ADAPT_INTERVAL_MS 2000
 
 static const uint32_t ega_palette[16] = {
     0x000000,
@@ -165,11 +173,10 @@ CharsetTexture* SDL2Driver::loadCharsetFromBytes(const uint8_t *buf, size_t len)
     return tex;
 }
 
+// The game clock is derived from the performance counter (see pit_ticks());
+// this timer only latches sound playback on PIT boundaries.
 uint32_t ZZT::pitTimerCallback(uint32_t interval, SDL2Driver *driver) {
-    driver->timer_hsecs += (PIT_SPEED_MS) / 5;
-    driver->soundSimulator->allowed = driver->_queue.is_playing;
-
-    driver->wake(IMUntilPit);
+    driver->sound_set_allowed(driver->_queue.is_playing());
     return PIT_SPEED_MS;
 }
 
@@ -244,7 +251,9 @@ static JoyButton sdl_to_pc_joybutton(SDL_GameControllerButton button) {
 }
 
 uint32_t ZZT::videoInputThread(SDL2Driver *driver) {
+    TRACE_THREAD_NAME("render");
     while (driver->renderThreadRunning) {
+        TRACE_SCOPE("frame");
         SDL_LockMutex(driver->inputMutex);
 
         SDL_Event event;
@@ -322,21 +331,49 @@ uint32_t ZZT::videoInputThread(SDL2Driver *driver) {
 
         SDL_RenderPresent(driver->renderer);
         driver->wake(IMUntilFrame);
+        driver->update_audio_buffer();
         SDL_Delay(1);
     }
     return 0;
 }
 
 uint32_t ZZT::gameThread(Game *game) {
+    TRACE_THREAD_NAME("game");
     game->GameTitleLoop();
     (static_cast<SDL2Driver*>(game->driver))->renderThreadRunning = false;
     return 0;
 }
 
 void ZZT::audioCallback(SDL2Driver *driver, uint8_t *stream, int32_t len) {
-    driver->sound_lock();
-    driver->soundSimulator->simulate((uint16_t*) stream, len >> 1);
-    driver->sound_unlock();
+    TRACE_THREAD_NAME("audio");
+    TRACE_SCOPE("audioCallback");
+    uint64_t start = SDL_GetPerformanceCounter();
+    int32_t samples;
+    if (driver->soundSimulatorFloat != nullptr) {
+        samples = len / sizeof(float);
+        driver->soundSimulatorFloat->simulate((float*) stream, samples);
+    } else {
+        samples = len / sizeof(int16_t);
+        driver->soundSimulatorS16->simulate((int16_t*) stream, samples);
+    }
+    uint64_t end = SDL_GetPerformanceCounter();
+
+    // The device is fed one buffer per callback; a callback arriving well
+    // after the previous buffer's playback time means the device ran dry.
+    SDL2AudioStats &stats = driver->audio_stats;
+    uint64_t buffer_length = driver->timer_frequency * samples / driver->audioSpec.freq;
+    if (driver->audio_last_callback != 0 && (start - driver->audio_last_callback) > (buffer_length + (buffer_length >> 1))) {
+        stats.underruns.fetch_add(1, std::memory_order_relaxed);
+        TRACE_INSTANT("audio underrun");
+    }
+    driver->audio_last_callback = start;
+
+    uint32_t duration_us = (end - start) * 1000000 / driver->timer_frequency;
+    stats.callback_total_us += duration_us;
+    if (duration_us > stats.callback_max_us) {
+        stats.callback_max_us = duration_us;
+    }
+    stats.callbacks.fetch_add(1, std::memory_order_relaxed);
 }
 
 SDL2Driver::SDL2Driver(int width_chars, int height_chars) {
@@ -346,11 +383,17 @@ SDL2Driver::SDL2Driver(int width_chars, int height_chars) {
     this->screen_buffer = (uint8_t*) malloc(width_chars * height_chars * sizeof(uint8_t) * 2);
     this->screen_buffer_changed = (bool*) malloc(width_chars * height_chars * sizeof(bool) * 2);
     memset(this->screen_buffer_changed, 0, width_chars * height_chars * sizeof(bool) * 2);
-    this->soundSimulator = new AudioSimulatorBandlimited<uint16_t>(&_queue, 48000, false);
+    this->soundSimulatorS16 = nullptr;
+    this->soundSimulatorFloat = nullptr;
+    this->audio_frequency = 48000;
+    this->audio_buffer_samples = AUDIO_BUFFER_DEFAULT;
+    this->audio_format = SDL2AudioFormatS16;
+    this->audio_adaptive = false;
 }
 
 SDL2Driver::~SDL2Driver() {
-    delete this->soundSimulator;
+    delete this->soundSimulatorS16;
+    delete this->soundSimulatorFloat;
     free(this->screen_buffer_changed);
     free(this->screen_buffer);
 }
@@ -358,7 +401,18 @@ SDL2Driver::~SDL2Driver() {
 void SDL2Driver::install(void) {
     if (!installed) {
         SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_TIMER | SDL_INIT_GAMECONTROLLER);
+        if (soundSimulatorFloat == nullptr && soundSimulatorS16 == nullptr) {
+            if (audio_format == SDL2AudioFormatFloat) {
+                soundSimulatorFloat = new AudioSimulatorBandlimited<float>(&_queue, audio_frequency, true);
+            } else {
+                soundSimulatorS16 = new AudioSimulatorBandlimited<int16_t>(&_queue, audio_frequency, true);
+            }
+        }
         SDL_StartTextInput();
+        timer_frequency = SDL_GetPerformanceFrequency();
+        timer_pit_length = timer_frequency * PIT_SPEED_MS / 1000;
+        timer_start = SDL_GetPerformanceCounter();
+        memset(&timing_stats, 0, sizeof(timing_stats));
         pit_timer_id = SDL_AddTimer(PIT_SPEED_MS, (SDL_TimerCallback) pitTimerCallback, this);
         for (int i = 0; i < IdleModeCount; i++) {
             timer_mutexes[i] = SDL_CreateMutex();
@@ -417,22 +471,14 @@ void SDL2Driver::install(void) {
         renderThreadRunning = true;
 
         // audio
-        soundBufferMutex = SDL_CreateMutex();
-        SDL_AudioSpec requestedAudioSpec;
-        memset(&requestedAudioSpec, 0, sizeof(SDL_AudioSpec));
-        requestedAudioSpec = {
-            .freq = 48000,
-            .format = AUDIO_U16,
-            .channels = 1,
-            .samples = 2048,
-            .callback = (SDL_AudioCallback) audioCallback,
-            .userdata = this
-        };
-        audioDevice = SDL_OpenAudioDevice(nullptr, 0, &requestedAudioSpec, &audioSpec, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE);
-        if (audioDevice != 0) {
-            soundSimulator->set_frequency(audioSpec.freq);
-            SDL_PauseAudioDevice(audioDevice, 0);
-        } else {
+        audio_stats.callbacks = 0;
+        audio_stats.underruns = 0;
+        audio_stats.callback_total_us = 0;
+        audio_stats.callback_max_us = 0;
+        audio_adapt_ticks = SDL_GetTicks();
+        audio_adapt_underruns = 0;
+        audio_adapt_done = !audio_adaptive;
+        if (!open_audio(audio_buffer_samples)) {
             fprintf(stderr, "[driver_sdl2] could not initialize audio device\n");
         }
 
@@ -448,7 +494,6 @@ void SDL2Driver::uninstall(void) {
         if (audioDevice != 0) {
             SDL_CloseAudioDevice(audioDevice);
         }
-        SDL_DestroyMutex(soundBufferMutex);
 
         // video
         // renderThreadRunning = false;
@@ -472,12 +517,50 @@ void SDL2Driver::uninstall(void) {
         }
         SDL_RemoveTimer(pit_timer_id);
         SDL_StopTextInput();
+
+        if (SDL_getenv("OPENZOO_TIMING_STATS") != nullptr && timing_stats.samples > 0) {
+            fprintf(stderr, "[driver_sdl2] PIT wakeups: %u, lateness avg %u us, max %u us\n",
+                timing_stats.samples, (uint32_t) (timing_stats.lateness_total_us / timing_stats.samples),
+                timing_stats.lateness_max_us);
+        }
+        if (SDL_getenv("OPENZOO_TIMING_STATS") != nullptr && audio_stats.callbacks > 0) {
+            fprintf(stderr, "[driver_sdl2] audio callbacks: %u, underruns %u, duration avg %u us, max %u us, buffer %d samples\n",
+                audio_stats.callbacks.load(), audio_stats.underruns.load(),
+                (uint32_t) (audio_stats.callback_total_us / audio_stats.callbacks), audio_stats.callback_max_us,
+                audioSpec.samples);
+        }
+
         SDL_Quit();
     }
 }
 
+uint32_t SDL2Driver::pit_ticks(uint64_t counter) {
+    return (counter - timer_start) / timer_pit_length;
+}
+
 uint16_t SDL2Driver::get_hsecs(void) {
-    return timer_hsecs >> 1;
+    // 5.5 hsecs per PIT tick, as with the DOS clock.
+    return ((uint16_t) (pit_ticks(SDL_GetPerformanceCounter()) * (PIT_SPEED_MS / 5))) >> 1;
+}
+
+void SDL2Driver::wait_until(uint64_t deadline) {
+    while (true) {
+        uint64_t now = SDL_GetPerformanceCounter();
+        if (now >= deadline) {
+            uint32_t lateness_us = (now - deadline) * 1000000 / timer_frequency;
+            timing_stats.samples++;
+            timing_stats.lateness_total_us += lateness_us;
+            if (lateness_us > timing_stats.lateness_max_us) {
+                timing_stats.lateness_max_us = lateness_us;
+            }
+            return;
+        }
+
+        // Sleep coarsely while far away, then yield until the deadline;
+        // SDL_Delay alone can overshoot by a scheduler quantum.
+        uint32_t remaining_ms = (deadline - now) * 1000 / timer_frequency;
+        SDL_Delay(remaining_ms > 2 ? (remaining_ms - 2) : 0);
+    }
 }
 
 void SDL2Driver::delay(int ms) {
@@ -492,6 +575,11 @@ void SDL2Driver::wake(IdleMode mode) {
 
 void SDL2Driver::idle(IdleMode mode) {
     if (mode == IMYield) return;
+    if (mode == IMUntilPit) {
+        uint64_t now = SDL_GetPerformanceCounter();
+        wait_until(timer_start + (uint64_t) (pit_ticks(now) + 1) * timer_pit_length);
+        return;
+    }
     SDL_LockMutex(timer_mutexes[mode]);
     SDL_CondWait(timer_conds[mode], timer_mutexes[mode]);
     SDL_UnlockMutex(timer_mutexes[mode]);
@@ -506,6 +594,17 @@ void SDL2Driver::draw_char(int16_t x, int16_t y, uint8_t col, uint8_t chr) {
     SDL_UnlockMutex(playfieldMutex);
 }
 
+void SDL2Driver::draw_char_batch(const CharCell *cells, int count) {
+    SDL_LockMutex(playfieldMutex);
+    for (int i = 0; i < count; i++) {
+        int offset = (cells[i].y * width_chars + cells[i].x) << 1;
+        screen_buffer[offset] = cells[i].chr;
+        screen_buffer_changed[offset++] = true;
+        screen_buffer[offset] = cells[i].col;
+    }
+    SDL_UnlockMutex(playfieldMutex);
+}
+
 void SDL2Driver::read_char(int16_t x, int16_t y, uint8_t &col, uint8_t &chr) {
     int offset = (y * width_chars + x) << 1;
     chr = screen_buffer[offset++];
@@ -580,17 +679,77 @@ void SDL2Driver::update_input(void) {
 }
 
 void SDL2Driver::sound_stop(void) {
-    sound_lock();
-    soundSimulator->clear();
-    sound_unlock();
+    if (soundSimulatorFloat != nullptr) {
+        soundSimulatorFloat->clear();
+    } else if (soundSimulatorS16 != nullptr) {
+        soundSimulatorS16->clear();
+    }
 }
 
-void SDL2Driver::sound_lock(void) {
-    SDL_LockMutex(soundBufferMutex);
+void SDL2Driver::sound_set_allowed(bool allowed) {
+    if (soundSimulatorFloat != nullptr) {
+        soundSimulatorFloat->allowed = allowed;
+    } else if (soundSimulatorS16 != nullptr) {
+        soundSimulatorS16->allowed = allowed;
+    }
 }
 
-void SDL2Driver::sound_unlock(void) {
-    SDL_UnlockMutex(soundBufferMutex);
+bool SDL2Driver::open_audio(int buffer_samples) {
+    SDL_AudioSpec requestedAudioSpec;
+    memset(&requestedAudioSpec, 0, sizeof(SDL_AudioSpec));
+    requestedAudioSpec.freq = audio_frequency;
+    requestedAudioSpec.format = (audio_format == SDL2AudioFormatFloat) ? AUDIO_F32SYS : AUDIO_S16SYS;
+    requestedAudioSpec.channels = 1;
+    requestedAudioSpec.samples = buffer_samples;
+    requestedAudioSpec.callback = (SDL_AudioCallback) audioCallback;
+    requestedAudioSpec.userdata = this;
+
+    // SDL converts to the device's native format if it differs
+    audio_last_callback = 0;
+    audioDevice = SDL_OpenAudioDevice(nullptr, 0, &requestedAudioSpec, &audioSpec, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE);
+    if (audioDevice == 0) {
+        return false;
+    }
+
+    if (soundSimulatorFloat != nullptr) {
+        soundSimulatorFloat->set_frequency(audioSpec.freq);
+    } else {
+        soundSimulatorS16->set_frequency(audioSpec.freq);
+    }
+    SDL_PauseAudioDevice(audioDevice, 0);
+    return true;
+}
+
+// Adaptive mode: halve the buffer every AUDIO_ADAPT_INTERVAL_MS without
+// underruns, and settle one step above the size which produced them.
+void SDL2Driver::update_audio_buffer(void) {
+    if (audio_adapt_done || audioDevice == 0) return;
+    uint32_t ticks = SDL_GetTicks();
+    if ((ticks - audio_adapt_ticks) < AUDIO_ADAPT_INTERVAL_MS) return;
+    audio_adapt_ticks = ticks;
+
+    int buffer_samples = audioSpec.samples;
+    if (audio_stats.underruns != audio_adapt_underruns) {
+        audio_adapt_done = true;
+        if (buffer_samples >= audio_buffer_samples) {
+            // underruns at the configured size; nothing to go back to
+            audio_adapt_underruns = audio_stats.underruns;
+            return;
+        }
+        buffer_samples <<= 1;
+    } else if (buffer_samples > AUDIO_BUFFER_MIN) {
+        buffer_samples >>= 1;
+    } else {
+        audio_adapt_done = true;
+        return;
+    }
+
+    SDL_CloseAudioDevice(audioDevice);
+    if (!open_audio(buffer_samples)) {
+        fprintf(stderr, "[driver_sdl2] could not reopen audio device\n");
+        audio_adapt_done = true;
+    }
+    audio_adapt_underruns = audio_stats.underruns;
 }
 
 UserInterface *SDL2Driver::create_user_interface(Game &game, bool is_editor) {
@@ -603,15 +762,76 @@ UserInterface *SDL2Driver::create_user_interface(Game &game, bool is_editor) {
 	}
 }
 
-static Game *game;
+// OPENZOO_AUDIO_BUFFER: buffer size in samples, or "auto" for adaptive
+// OPENZOO_AUDIO_FORMAT: "s16" (default) or "float"
+// OPENZOO_AUDIO_RATE: sample rate in Hz
+static void configure_audio(SDL2Driver &driver) {
+    const char *value;
+
+    if ((value = SDL_getenv("OPENZOO_AUDIO_BUFFER")) != nullptr) {
+        if (!strcmp(value, "auto")) {
+            driver.audio_adaptive = true;
+            driver.audio_buffer_samples = 2048;
+        } else {
+            int samples = atoi(value);
+            driver.audio_buffer_samples = AUDIO_BUFFER_MIN;
+            while (driver.audio_buffer_samples < samples && driver.audio_buffer_samples < AUDIO_BUFFER_MAX) {
+                driver.audio_buffer_samples <<= 1;
+            }
+        }
+    }
+
+    if ((value = SDL_getenv("OPENZOO_AUDIO_FORMAT")) != nullptr) {
+        if (!strcmp(value, "float")) {
+            driver.audio_format = SDL2AudioFormatFloat;
+        } else if (!strcmp(value, "s16")) {
+            driver.audio_format = SDL2AudioFormatS16;
+        } else {
+            fprintf(stderr, "[driver_sdl2] unknown audio format %s\n", value);
+        }
+    }
+
+    if ((value = SDL_getenv("OPENZOO_AUDIO_RATE")) != nullptr && atoi(value) > 0) {
+        driver.audio_frequency = atoi(value);
+    }
+}
 
 int main(int argc, char** argv) {
 	SDL2Driver driver = SDL2Driver(80, 25);
-    game = new Game();
+	configure_audio(driver);
+    Game *game = new Game();
 
 	game->driver = &driver;
     game->filesystem = new PosixFilesystemDriver();
 
+    // OPENZOO_FAST_FORWARD: start with fast-forward on, at this many game ticks per frame
+    const char *fastForward = SDL_getenv("OPENZOO_FAST_FORWARD");
+    if (fastForward != nullptr) {
+        game->SetFastForward(atoi(fastForward));
+    }
+
+    // OPENZOO_PROFILE: run the tick profiler from the start
+    if (SDL_getenv("OPENZOO_PROFILE") != nullptr) {
+        game->profiler.start();
+    }
+
+    // OPENZOO_RECORD: record the session to this file, for openzoo-replay
+    SessionRecorder recorder;
+    const char *recordName = SDL_getenv("OPENZOO_RECORD");
+    if (recordName != nullptr) {
+        if (!recorder.open(recordName, *game)) {
+            fprintf(stderr, "[driver_sdl2] could not open session recording %s\n", recordName);
+            return 1;
+        }
+        driver.recorder = &recorder;
+    }
+
+    // OPENZOO_TRACE: write a trace of this session to this file (tracing builds only)
+    const char *traceName = SDL_getenv("OPENZOO_TRACE");
+    if (traceName != nullptr && !TraceStart(traceName)) {
+        fprintf(stderr, "[driver_sdl2] could not start trace %s\n", traceName);
+    }
+
 	driver.install();
 
 	driver.clrscr();
@@ -621,6 +841,14 @@ int main(int argc, char** argv) {
     videoInputThread(&driver);
 
 	driver.uninstall();
+    recorder.close();
+    TraceStop();
+
+    if (game->profiler.has_data()) {
+        game->profiler.report(*game, [](const char *line) {
+            fprintf(stderr, "[driver_sdl2] profile: %s\n", line);
+        });
+    }
 
     delete game->filesystem;
     delete game;
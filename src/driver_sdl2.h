@@ -1,6 +1,7 @@
 #ifndef __DRIVER_SDL2_H__
 #define __DRIVER_SDL2_H__
 
+#include <atomic>
 #include <cstdint>
 #include "driver.h"
 #include "audio_simulator.h"
@@ -23,6 +24,26 @@ namespace ZZT {
         ~CharsetTexture();
     };
 
+    // Lateness of idle(IMUntilPit) wakeups relative to the PIT tick boundary.
+    struct SDL2TimingStats {
+        uint32_t samples;
+        uint64_t lateness_total_us;
+        uint32_t lateness_max_us;
+    };
+
+    typedef enum {
+        SDL2AudioFormatS16,
+        SDL2AudioFormatFloat
+    } SDL2AudioFormat;
+
+    // Audio callback statistics. The counters are updated by the audio thread.
+    struct SDL2AudioStats {
+        std::atomic<uint32_t> callbacks;
+        std::atomic<uint32_t> underruns; // callbacks arriving after the previous buffer ran out
+        uint64_t callback_total_us;
+        uint32_t callback_max_us;
+    };
+
     class SDL2Driver: public Driver {
         friend uint32_t pitTimerCallback(uint32_t interval, SDL2Driver *driver);
         friend uint32_t videoInputThread(SDL2Driver *driver);
@@ -33,10 +54,17 @@ namespace ZZT {
         int16_t width_chars, height_chars;
         bool installed;
         SDL_TimerID pit_timer_id;
-        uint16_t timer_hsecs;
         SDL_mutex *timer_mutexes[IdleModeCount];
         SDL_cond *timer_conds[IdleModeCount];
 
+        // timing (in performance counter units)
+        uint64_t timer_frequency;
+        uint64_t timer_start;
+        uint64_t timer_pit_length;
+        SDL2TimingStats timing_stats;
+
+        uint32_t pit_ticks(uint64_t counter);
+        void wait_until(uint64_t deadline);
         void wake(IdleMode mode);
         void update_keymod(uint16_t kmod);
 
@@ -65,18 +93,36 @@ namespace ZZT {
         void render_char_fg(int16_t x, int16_t y, bool blink);
 
         // audio
-        AudioSimulator<uint16_t> *soundSimulator;
-        SDL_mutex *soundBufferMutex;
+        AudioSimulator<int16_t> *soundSimulatorS16;
+        AudioSimulator<float> *soundSimulatorFloat;
         SDL_AudioDeviceID audioDevice;
         SDL_AudioSpec audioSpec;
+        SDL2AudioStats audio_stats;
+        uint64_t audio_last_callback;
+        uint32_t audio_adapt_ticks;
+        uint32_t audio_adapt_underruns;
+        bool audio_adapt_done;
+
+        bool open_audio(int buffer_samples);
+        void update_audio_buffer(void);
+        void sound_set_allowed(bool allowed);
 
     public:
         SDL2Driver(int width_chars, int height_chars);
         ~SDL2Driver();
 
+        // audio configuration, set before install()
+        int audio_frequency;
+        int audio_buffer_samples; // device buffer size, a power of two
+        SDL2AudioFormat audio_format;
+        bool audio_adaptive; // halve the buffer while no underruns occur
+
         void install(void);
         void uninstall(void);
 
+        const SDL2TimingStats &get_timing_stats(void) const { return timing_stats; }
+        const SDL2AudioStats &get_audio_stats(void) const { return audio_stats; }
+
 		UserInterface *create_user_interface(Game &game, bool is_editor) override;
 
         // required (input)
@@ -87,14 +133,13 @@ namespace ZZT {
         void delay(int ms) override;
         void idle(IdleMode mode) override;
         void sound_stop(void) override;
-        void sound_lock(void) override;
-        void sound_unlock(void) override;
 
         // required (video)
         void draw_char(int16_t x, int16_t y, uint8_t col, uint8_t chr) override;
         void read_char(int16_t x, int16_t y, uint8_t &col, uint8_t &chr) override;
         bool set_video_size(int16_t width, int16_t height, bool simulate) override;
         void draw_string(int16_t x, int16_t y, uint8_t col, const char *str) override;
+        void draw_char_batch(const CharCell *cells, int count) override;
         void clrscr(void) override;
     };
 }
@@ -0,0 +1,483 @@
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <csignal>
+#include <ctime>
+#include <termios.h>
+#include <unistd.h>
+#include "driver_tty.h"
+#include "filesystem_posix.h"
+#include "replay.h"
+#include "trace.h"
+#include "gamevars.h"
+
+#define PIT_SPEED_MS 55
+#define TTY_CELL_UNKNOWN 0xFFFF
+#define TTY_MOVE_REWRITE_MAX 4
+
+// CP437 glyphs as Unicode code points.
+static const uint16_t cp437_to_unicode[256] = {
+    0x0020, 0x263A, 0x263B, 0x2665, 0x2666, 0x2663, 0x2660, 0x2022, 0x25D8, 0x25CB, 0x25D9, 0x2642, 0x2640, 0x266A, 0x266B, 0x263C,
+    0x25BA, 0x25C4, 0x2195, 0x203C, 0x00B6, 0x00A7, 0x25AC, 0x21A8, 0x2191, 0x2193, 0x2192, 0x2190, 0x221F, 0x2194, 0x25B2, 0x25BC,
+    0x0020, 0x0021, 0x0022, 0x0023, 0x0024, 0x0025, 0x0026, 0x0027, 0x0028, 0x0029, 0x002A, 0x002B, 0x002C, 0x002D, 0x002E, 0x002F,
+    0x0030, 0x0031, 0x0032, 0x0033, 0x0034, 0x0035, 0x0036, 0x0037, 0x0038, 0x0039, 0x003A, 0x003B, 0x003C, 0x003D, 0x003E, 0x003F,
+    0x0040, 0x0041, 0x0042, 0x0043, 0x0044, 0x0045, 0x0046, 0x0047, 0x0048, 0x0049, 0x004A, 0x004B, 0x004C, 0x004D, 0x004E, 0x004F,
+    0x0050, 0x0051, 0x0052, 0x0053, 0x0054, 0x0055, 0x0056, 0x0057, 0x0058, 0x0059, 0x005A, 0x005B, 0x005C, 0x005D, 0x005E, 0x005F,
+    0x0060, 0x0061, 0x0062, 0x0063, 0x0064, 0x0065, 0x0066, 0x0067, 0x0068, 0x0069, 0x006A, 0x006B, 0x006C, 0x006D, 0x006E, 0x006F,
+    0x0070, 0x0071, 0x0072, 0x0073, 0x0074, 0x0075, 0x0076, 0x0077, 0x0078, 0x0079, 0x007A, 0x007B, 0x007C, 0x007D, 0x007E, 0x2302,
+    0x00C7, 0x00FC, 0x00E9, 0x00E2, 0x00E4, 0x00E0, 0x00E5, 0x00E7, 0x00EA, 0x00EB, 0x00E8, 0x00EF, 0x00EE, 0x00EC, 0x00C4, 0x00C5,
+    0x00C9, 0x00E6, 0x00C6, 0x00F4, 0x00F6, 0x00F2, 0x00FB, 0x00F9, 0x00FF, 0x00D6, 0x00DC, 0x00A2, 0x00A3, 0x00A5, 0x20A7, 0x0192,
+    0x00E1, 0x00ED, 0x00F3, 0x00FA, 0x00F1, 0x00D1, 0x00AA, 0x00BA, 0x00BF, 0x2310, 0x00AC, 0x00BD, 0x00BC, 0x00A1, 0x00AB, 0x00BB,
+    0x2591, 0x2592, 0x2593, 0x2502, 0x2524, 0x2561, 0x2562, 0x2556, 0x2555, 0x2563, 0x2551, 0x2557, 0x255D, 0x255C, 0x255B, 0x2510,
+    0x2514, 0x2534, 0x252C, 0x251C, 0x2500, 0x253C, 0x255E, 0x255F, 0x255A, 0x2554, 0x2569, 0x2566, 0x2560, 0x2550, 0x256C, 0x2567,
+    0x2568, 0x2564, 0x2565, 0x2559, 0x2558, 0x2552, 0x2553, 0x256B, 0x256A, 0x2518, 0x250C, 0x2588, 0x2584, 0x258C, 0x2590, 0x2580,
+    0x03B1, 0x00DF, 0x0393, 0x03C0, 0x03A3, 0x03C3, 0x00B5, 0x03C4, 0x03A6, 0x0398, 0x03A9, 0x03B4, 0x221E, 0x03C6, 0x03B5, 0x2229,
+    0x2261, 0x00B1, 0x2265, 0x2264, 0x2320, 0x2321, 0x00F7, 0x2248, 0x00B0, 0x2219, 0x00B7, 0x221A, 0x207F, 0x00B2, 0x25A0, 0x0020
+};
+
+// EGA color index -> ANSI color index
+static const uint8_t ega_to_ansi[8] = {0, 4, 2, 6, 1, 5, 3, 7};
+
+using namespace ZZT;
+
+static struct termios tty_saved_termios;
+static bool tty_termios_saved = false;
+
+static void tty_restore_terminal(void) {
+    if (tty_termios_saved) {
+        static const char reset[] = "\x1b[0m\x1b[?25h\x1b[?1049l";
+        write(STDOUT_FILENO, reset, sizeof(reset) - 1);
+        tcsetattr(STDIN_FILENO, TCSAFLUSH, &tty_saved_termios);
+        tty_termios_saved = false;
+    }
+}
+
+static void tty_signal_handler(int signum) {
+    tty_restore_terminal();
+    _exit(128 + signum);
+}
+
+TTYDriver::TTYDriver(int width_chars, int height_chars) {
+    this->installed = false;
+    this->width_chars = width_chars;
+    this->height_chars = height_chars;
+    this->screen_buffer = (uint8_t*) malloc(width_chars * height_chars * sizeof(uint8_t) * 2);
+    memset(this->screen_buffer, 0, width_chars * height_chars * sizeof(uint8_t) * 2);
+    this->shadow_buffer = (uint16_t*) malloc(width_chars * height_chars * sizeof(uint16_t));
+    this->out_size = 4096;
+    this->out_buffer = (uint8_t*) malloc(this->out_size);
+    this->out_len = 0;
+    this->bytes_written = 0;
+
+    for (int i = 0; i < 256; i++) {
+        uint16_t cp = cp437_to_unicode[i];
+        uint8_t *u = utf8_table[i];
+        if (cp < 0x80) {
+            u[0] = 1; u[1] = cp;
+        } else if (cp < 0x800) {
+            u[0] = 2; u[1] = 0xC0 | (cp >> 6); u[2] = 0x80 | (cp & 0x3F);
+        } else {
+            u[0] = 3; u[1] = 0xE0 | (cp >> 12); u[2] = 0x80 | ((cp >> 6) & 0x3F); u[3] = 0x80 | (cp & 0x3F);
+        }
+    }
+}
+
+TTYDriver::~TTYDriver() {
+    uninstall();
+    free(this->out_buffer);
+    free(this->shadow_buffer);
+    free(this->screen_buffer);
+}
+
+void TTYDriver::install(void) {
+    if (!installed) {
+        if (tcgetattr(STDIN_FILENO, &tty_saved_termios) != 0) {
+            fprintf(stderr, "[driver_tty] stdin is not a terminal\n");
+            exit(1);
+        }
+        tty_termios_saved = true;
+        atexit(tty_restore_terminal);
+        signal(SIGINT, tty_signal_handler);
+        signal(SIGTERM, tty_signal_handler);
+        signal(SIGHUP, tty_signal_handler);
+
+        struct termios raw = tty_saved_termios;
+        raw.c_iflag &= ~(IXON | ICRNL | INLCR | IGNCR | ISTRIP | BRKINT);
+        raw.c_oflag &= ~(OPOST);
+        raw.c_lflag &= ~(ICANON | ECHO | IEXTEN);
+        raw.c_cc[VMIN] = 0;
+        raw.c_cc[VTIME] = 0;
+        tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw);
+
+        // alternate screen, hide cursor, reset attributes, clear
+        out_str("\x1b[?1049h\x1b[?25l\x1b[0m\x1b[2J");
+        for (int i = 0; i < width_chars * height_chars; i++) {
+            shadow_buffer[i] = TTY_CELL_UNKNOWN;
+        }
+        cursor_x = -1;
+        cursor_y = -1;
+        sgr_col = -1;
+
+        timer_start_us = now_us();
+        presented_pit = 0;
+        installed = true;
+    }
+}
+
+void TTYDriver::uninstall(void) {
+    if (installed) {
+        installed = false;
+        present();
+        tty_restore_terminal();
+        signal(SIGINT, SIG_DFL);
+        signal(SIGTERM, SIG_DFL);
+        signal(SIGHUP, SIG_DFL);
+        fprintf(stderr, "[driver_tty] %llu bytes written\n", (unsigned long long) bytes_written);
+    }
+}
+
+/* OUTPUT */
+
+void TTYDriver::out_bytes(const void *data, size_t len) {
+    if ((out_len + len) > out_size) {
+        while ((out_len + len) > out_size) out_size <<= 1;
+        out_buffer = (uint8_t*) realloc(out_buffer, out_size);
+    }
+    memcpy(out_buffer + out_len, data, len);
+    out_len += len;
+}
+
+void TTYDriver::out_str(const char *str) {
+    out_bytes(str, strlen(str));
+}
+
+void TTYDriver::out_move_cursor(int16_t x, int16_t y) {
+    if (cursor_x == x && cursor_y == y) return;
+
+    char cup[16];
+    int cup_len = (x == 0)
+        ? snprintf(cup, sizeof(cup), "\x1b[%dH", y + 1)
+        : snprintf(cup, sizeof(cup), "\x1b[%d;%dH", y + 1, x + 1);
+
+    if (cursor_y == y && cursor_x >= 0 && cursor_x < x) {
+        // Rewriting a few unchanged cells is often cheaper than any
+        // escape sequence, as long as they share the current attribute.
+        int gap = x - cursor_x;
+        if (gap <= TTY_MOVE_REWRITE_MAX) {
+            int rewrite_len = 0;
+            for (int ix = cursor_x; ix < x; ix++) {
+                uint16_t cell = shadow_buffer[y * width_chars + ix];
+                if (cell == TTY_CELL_UNKNOWN || (cell >> 8) != sgr_col) {
+                    rewrite_len = -1;
+                    break;
+                }
+                rewrite_len += utf8_table[cell & 0xFF][0];
+            }
+            if (rewrite_len >= 0 && rewrite_len <= 3) {
+                for (int ix = cursor_x; ix < x; ix++) {
+                    const uint8_t *u = utf8_table[shadow_buffer[y * width_chars + ix] & 0xFF];
+                    out_bytes(u + 1, u[0]);
+                }
+                cursor_x = x;
+                return;
+            }
+        }
+
+        char cuf[16];
+        int cuf_len = (gap == 1)
+            ? snprintf(cuf, sizeof(cuf), "\x1b[C")
+            : snprintf(cuf, sizeof(cuf), "\x1b[%dC", gap);
+        if (cuf_len < cup_len) {
+            out_bytes(cuf, cuf_len);
+            cursor_x = x;
+            return;
+        }
+    } else if (x == 0 && cursor_y >= 0 && cursor_y == (y - 1)) {
+        out_bytes("\r\n", 2);
+        cursor_x = 0;
+        cursor_y = y;
+        return;
+    }
+
+    out_bytes(cup, cup_len);
+    cursor_x = x;
+    cursor_y = y;
+}
+
+void TTYDriver::out_sgr(uint8_t col) {
+    if (sgr_col == col) return;
+
+    char sgr[24];
+    int len = 2;
+    sgr[0] = '\x1b';
+    sgr[1] = '[';
+
+    bool reset = sgr_col < 0;
+    if (reset) {
+        sgr[len++] = '0';
+        sgr[len++] = ';';
+    }
+    if (reset || ((sgr_col ^ col) & 0x0F)) {
+        len += snprintf(sgr + len, sizeof(sgr) - len, "%d;", ((col & 0x08) ? 90 : 30) + ega_to_ansi[col & 0x07]);
+    }
+    if (reset || ((sgr_col ^ col) & 0x70)) {
+        len += snprintf(sgr + len, sizeof(sgr) - len, "%d;", 40 + ega_to_ansi[(col >> 4) & 0x07]);
+    }
+    if ((col & 0x80) ? (reset || !(sgr_col & 0x80)) : (!reset && (sgr_col & 0x80))) {
+        len += snprintf(sgr + len, sizeof(sgr) - len, "%s;", (col & 0x80) ? "5" : "25");
+    }
+
+    sgr[len - 1] = 'm';
+    out_bytes(sgr, len);
+    sgr_col = col;
+}
+
+void TTYDriver::present(void) {
+    presented_pit = pit_ticks();
+
+    for (int16_t iy = 0; iy < height_chars; iy++) {
+        for (int16_t ix = 0; ix < width_chars; ix++) {
+            int offset = iy * width_chars + ix;
+            uint8_t chr = screen_buffer[offset << 1];
+            uint8_t col = screen_buffer[(offset << 1) + 1];
+            uint16_t cell = chr | (col << 8);
+            if (shadow_buffer[offset] == cell) continue;
+
+            out_move_cursor(ix, iy);
+            out_sgr(col);
+            out_bytes(utf8_table[chr] + 1, utf8_table[chr][0]);
+            shadow_buffer[offset] = cell;
+
+            // Writing the last column leaves the cursor in a terminal-specific state.
+            cursor_x = (ix + 1) < width_chars ? (ix + 1) : -1;
+        }
+    }
+
+    size_t pos = 0;
+    while (pos < out_len) {
+        ssize_t written = write(STDOUT_FILENO, out_buffer + pos, out_len - pos);
+        if (written <= 0) break;
+        pos += written;
+    }
+    bytes_written += out_len;
+    out_len = 0;
+}
+
+/* INPUT */
+
+void TTYDriver::read_input(void) {
+    uint8_t buf[64];
+    ssize_t len = read(STDIN_FILENO, buf, sizeof(buf));
+    set_key_modifier_state(KeyModLeftShift, false);
+    if (len <= 0) return;
+
+    for (ssize_t i = 0; i < len; i++) {
+        uint8_t c = buf[i];
+        if (c != 0x1B) {
+            switch (c) {
+                case 0x7F: set_key_pressed(KeyBackspace, true, true); break;
+                case '\r': case '\n': set_key_pressed(KeyEnter, true, true); break;
+                default: set_key_pressed(c, true, true); break;
+            }
+            continue;
+        }
+
+        if ((i + 1) >= len || (buf[i + 1] != '[' && buf[i + 1] != 'O')) {
+            set_key_pressed(KeyEscape, true, true);
+            continue;
+        }
+
+        // CSI/SS3 sequence: ESC [ params final, or ESC O final
+        i += 2;
+        int params[2] = {0, 0};
+        int param_count = 0;
+        while (i < len && ((buf[i] >= '0' && buf[i] <= '9') || buf[i] == ';')) {
+            if (buf[i] == ';') {
+                if (param_count < 1) param_count++;
+            } else {
+                params[param_count] = params[param_count] * 10 + (buf[i] - '0');
+            }
+            i++;
+        }
+        if (i >= len) break;
+
+        // modifier parameter: 2 = shift
+        int modifier = param_count > 0 ? params[1] : 0;
+        if (modifier > 0 && ((modifier - 1) & 1)) {
+            set_key_modifier_state(KeyModLeftShift, true);
+        }
+
+        uint16_t key = 0;
+        switch (buf[i]) {
+            case 'A': key = KeyUp; break;
+            case 'B': key = KeyDown; break;
+            case 'C': key = KeyRight; break;
+            case 'D': key = KeyLeft; break;
+            case 'H': key = KeyHome; break;
+            case 'F': key = KeyEnd; break;
+            case 'P': key = KeyF1; break;
+            case 'Q': key = KeyF2; break;
+            case 'R': key = KeyF3; break;
+            case 'S': key = KeyF4; break;
+            case 'Z': key = KeyTab; set_key_modifier_state(KeyModLeftShift, true); break;
+            case '~': switch (params[0]) {
+                case 1: case 7: key = KeyHome; break;
+                case 2: key = KeyInsert; break;
+                case 3: key = KeyDelete; break;
+                case 4: case 8: key = KeyEnd; break;
+                case 5: key = KeyPageUp; break;
+                case 6: key = KeyPageDown; break;
+                case 11: key = KeyF1; break;
+                case 12: key = KeyF2; break;
+                case 13: key = KeyF3; break;
+                case 14: key = KeyF4; break;
+                case 15: key = KeyF5; break;
+                case 17: key = KeyF6; break;
+                case 18: key = KeyF7; break;
+                case 19: key = KeyF8; break;
+                case 20: key = KeyF9; break;
+                case 21: key = KeyF10; break;
+            } break;
+        }
+        if (key != 0) {
+            set_key_pressed(key, true, true);
+        }
+    }
+}
+
+void TTYDriver::update_input(void) {
+    read_input();
+    // Arrow keys arrive as KeyUp/KeyDown/..., which advance_input() feeds to set_dpad().
+    advance_input();
+}
+
+/* SOUND/TIMER */
+
+uint64_t TTYDriver::now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t) ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
+}
+
+uint32_t TTYDriver::pit_ticks(void) {
+    return (now_us() - timer_start_us) / (PIT_SPEED_MS * 1000);
+}
+
+void TTYDriver::sleep_until_us(uint64_t deadline) {
+    uint64_t now = now_us();
+    if (deadline > now) {
+        struct timespec ts;
+        ts.tv_sec = (deadline - now) / 1000000;
+        ts.tv_nsec = ((deadline - now) % 1000000) * 1000;
+        nanosleep(&ts, nullptr);
+    }
+}
+
+uint16_t TTYDriver::get_hsecs(void) {
+    return ((uint16_t) (pit_ticks() * (PIT_SPEED_MS / 5))) >> 1;
+}
+
+void TTYDriver::delay(int ms) {
+    present();
+    sleep_until_us(now_us() + ms * 1000);
+}
+
+void TTYDriver::idle(IdleMode mode) {
+    if (mode == IMYield) {
+        // At the fastest game speed, still send at most one frame per PIT tick.
+        if (pit_ticks() != presented_pit) present();
+        return;
+    }
+
+    present();
+    sleep_until_us(timer_start_us + (uint64_t) (pit_ticks() + 1) * (PIT_SPEED_MS * 1000));
+}
+
+void TTYDriver::sound_stop(void) {
+
+}
+
+/* VIDEO */
+
+void TTYDriver::draw_char(int16_t x, int16_t y, uint8_t col, uint8_t chr) {
+    int offset = (y * width_chars + x) << 1;
+    screen_buffer[offset] = chr;
+    screen_buffer[offset + 1] = col;
+}
+
+void TTYDriver::read_char(int16_t x, int16_t y, uint8_t &col, uint8_t &chr) {
+    int offset = (y * width_chars + x) << 1;
+    chr = screen_buffer[offset];
+    col = screen_buffer[offset + 1];
+}
+
+void TTYDriver::clrscr(void) {
+    memset(screen_buffer, 0, width_chars * height_chars * sizeof(uint8_t) * 2);
+}
+
+int main(int argc, char** argv) {
+	TTYDriver driver = TTYDriver(80, 25);
+	Game *game = new Game();
+
+	game->driver = &driver;
+	game->filesystem = new PosixFilesystemDriver();
+
+	if (argc > 1) {
+		// WorldLoad appends the extension itself.
+		StrCopy(game->startupWorldFileName, argv[1]);
+		int len = StrLength(game->startupWorldFileName);
+		if (len > 4 && game->startupWorldFileName[len - 4] == '.') {
+			game->startupWorldFileName[len - 4] = 0;
+		}
+	}
+
+	// OPENZOO_FAST_FORWARD: start with fast-forward on, at this many game ticks per frame
+	const char *fastForward = getenv("OPENZOO_FAST_FORWARD");
+	if (fastForward != nullptr) {
+		game->SetFastForward(atoi(fastForward));
+	}
+
+	// OPENZOO_PROFILE: run the tick profiler from the start
+	if (getenv("OPENZOO_PROFILE") != nullptr) {
+		game->profiler.start();
+	}
+
+	// OPENZOO_RECORD: record the session to this file, for openzoo-replay
+	SessionRecorder recorder;
+	const char *recordName = getenv("OPENZOO_RECORD");
+	if (recordName != nullptr) {
+		if (!recorder.open(recordName, *game)) {
+			fprintf(stderr, "[driver_tty] could not open session recording %s\n", recordName);
+			return 1;
+		}
+		driver.recorder = &recorder;
+	}
+
+	// OPENZOO_TRACE: write a trace of this session to this file (tracing builds only)
+	const char *traceName = getenv("OPENZOO_TRACE");
+	if (traceName != nullptr && !TraceStart(traceName)) {
+		fprintf(stderr, "[driver_tty] could not start trace %s\n", traceName);
+	}
+
+	driver.install();
+
+	driver.clrscr();
+
+	game->GameTitleLoop();
+
+	driver.uninstall();
+	recorder.close();
+	TraceStop();
+
+	if (game->profiler.has_data()) {
+		game->profiler.report(*game, [](const char *line) {
+			fprintf(stderr, "[driver_tty] profile: %s\n", line);
+		});
+	}
+
+	delete game->filesystem;
+	delete game;
+
+	return 0;
+}
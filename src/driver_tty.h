@@ -0,0 +1,66 @@
+#ifndef __DRIVER_TTY_H__
+#define __DRIVER_TTY_H__
+
+#include <cstddef>
+#include <cstdint>
+#include "driver.h"
+
+namespace ZZT {
+    // Renders to a VT100/ANSI terminal on stdin/stdout. Only cells which differ
+    // from the shadow copy of the terminal's contents are sent.
+    class TTYDriver: public Driver {
+    private:
+        int16_t width_chars, height_chars;
+        bool installed;
+        uint8_t *screen_buffer;
+        uint16_t *shadow_buffer; // chr | (col << 8), or TTY_CELL_UNKNOWN
+        uint8_t utf8_table[256][4]; // [0] = length
+
+        // terminal state, as last sent
+        int16_t cursor_x, cursor_y; // -1 if unknown
+        int16_t sgr_col; // -1 if unknown
+
+        uint8_t *out_buffer;
+        size_t out_len, out_size;
+        uint32_t presented_pit;
+        uint64_t bytes_written;
+
+        uint64_t timer_start_us;
+
+        uint64_t now_us(void);
+        uint32_t pit_ticks(void);
+        void sleep_until_us(uint64_t deadline);
+
+        void out_bytes(const void *data, size_t len);
+        void out_str(const char *str);
+        void out_move_cursor(int16_t x, int16_t y);
+        void out_sgr(uint8_t col);
+        void present(void);
+        void read_input(void);
+
+    public:
+        TTYDriver(int width_chars, int height_chars);
+        ~TTYDriver();
+
+        void install(void);
+        void uninstall(void);
+
+        uint64_t get_bytes_written(void) const { return bytes_written; }
+
+        // required (input)
+        void update_input(void) override;
+
+        // required (sound)
+        uint16_t get_hsecs(void) override;
+        void delay(int ms) override;
+        void idle(IdleMode mode) override;
+        void sound_stop(void) override;
+
+        // required (video)
+        void draw_char(int16_t x, int16_t y, uint8_t col, uint8_t chr) override;
+        void read_char(int16_t x, int16_t y, uint8_t &col, uint8_t &chr) override;
+        void clrscr(void) override;
+    };
+}
+
+#endif
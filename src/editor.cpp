@@ -12,8 +12,7 @@ static const char EditorColorNames[16][4] = {
     "DGr", "LBl", "LGn", "LCy", "LRe", "LMa", "Yel", "Wht"
 };
 
-static uint8_t EditorPatterns[6];
-static constexpr size_t EditorPatternCount = sizeof(EditorPatterns) / sizeof(uint8_t);
+static constexpr size_t EditorPatternCount = EDITOR_PATTERN_COUNT;
 
 static const char NeighborBoardStrs[4][8] = {
     "Board \x18",
@@ -163,7 +162,11 @@ void Editor::CopyPattern(int16_t x, int16_t y, EditorCopiedTile &copied) {
     if (copied.has_stat) {
         const Stat &stat = game->board.stats[stat_id];
         copied.stat = stat;
-        copied.stat.data.duplicate();
+        // kept across boards, so not shared with the board's code
+        copied.stat.data.alloc_data(stat.data.len);
+        if (stat.data.len > 0) {
+            memcpy(copied.stat.data.data, stat.data.data, stat.data.len);
+        }
     }
     
     // generate preview
@@ -240,7 +243,7 @@ void Editor::DrawSidebar(void) {
 
     // patterns
     for (size_t i = 0; i < EditorPatternCount; i++) {
-        game->driver->draw_char(61 + i, 21, 0x0F, game->elementDef(EditorPatterns[i]).character);
+        game->driver->draw_char(61 + i, 21, 0x0F, game->elementDef(patterns[i]).character);
     }
     UpdateCopiedPatterns();
     UpdateCursorPattern();
@@ -263,12 +266,12 @@ void Editor::DrawRefresh(void) {
     sstring<128> name;
 
 	// TODO: Move elsewhere! This is a hack. We need a proper InitEngine call.
-    EditorPatterns[0] = ESolid;
-	EditorPatterns[1] = ENormal;
-	EditorPatterns[2] = EBreakable;
-	EditorPatterns[3] = game->hasElement(EFloor) ? EFloor : EWater;
-	EditorPatterns[4] = EEmpty;
-	EditorPatterns[5] = ELine;
+    patterns[0] = ESolid;
+	patterns[1] = ENormal;
+	patterns[2] = EBreakable;
+	patterns[3] = game->hasElement(EFloor) ? EFloor : EWater;
+	patterns[4] = EEmpty;
+	patterns[5] = ELine;
 
     game->BoardPointCameraAt(cursor_x, cursor_y);
 
@@ -329,7 +332,7 @@ void Editor::PlaceTile(int16_t x, int16_t y) {
     if (cursor_pattern < EditorPatternCount) {
         if (PrepareModifyTile(x, y)) {
             game->board.tiles.set(x, y, {
-                .element = EditorPatterns[cursor_pattern],
+                .element = patterns[cursor_pattern],
                 .color = cursor_color
             });
         }
@@ -481,7 +484,12 @@ void Editor::EditStatText(int16_t stat_id, const char *prompt) {
         for (int i = 0; i <= game->board.stats.count; i++) {
             affected_stats[i] = game->board.stats[i].data == stat.data;
         }
-        stat.data.free_data();
+        game->soundPatternCache.invalidate(stat.data.data);
+        for (int i = 0; i <= game->board.stats.count; i++) {
+            if (affected_stats[i]) {
+                game->board.stats[i].data.free_data();
+            }
+        }
     } else {
         memset(affected_stats, 0, game->board.stats.count + 2);
     }
@@ -498,7 +506,7 @@ void Editor::EditStatText(int16_t stat_id, const char *prompt) {
     for (int i = 0; i <= game->board.stats.count; i++) {
         if (i == stat_id) continue;
         if (affected_stats[i]) {
-            game->board.stats[i].data = stat.data;
+            game->board.stats[i].data.bind(stat.data);
         }
     }
 
@@ -5,6 +5,7 @@
 #include "gamevars.h"
 
 #define COPIED_TILES_COUNT 10
+#define EDITOR_PATTERN_COUNT 6
 
 namespace ZZT {
     typedef enum {
@@ -42,6 +43,7 @@ namespace ZZT {
         EditorDrawMode draw_mode;
         int16_t cursor_x, cursor_y;
         uint8_t cursor_pattern, cursor_color;
+        uint8_t patterns[EDITOR_PATTERN_COUNT];
         bool color_ignore_defaults;
         int16_t i;
         uint8_t i_elem;
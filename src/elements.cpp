@@ -8,8 +8,10 @@ static const uint8_t TransporterNSChars[8] = {'^', '~', '^', '-', 'v', '_', 'v',
 static const uint8_t TransporterEWChars[8] = {'(', '<', '(', 179, ')', '>', ')', 179};
 static const uint8_t StarAnimChars[4] = {179, '/', 196, '\\'};
 
+static constexpr TorchMask TorchMaskZZT = TorchMaskCreate(50, 2);
+static constexpr TorchMask TorchMaskSuperZZT = TorchMaskCreate(64, 1);
+
 static const uint8_t ForestSoundTable[8] = {0x45, 0x40, 0x47, 0x50, 0x46, 0x41, 0x48, 0x51};
-static uint8_t ForestSoundTableIdx; // TODO: Move to Game structure
 
 void ZZT::ElementDefaultDraw(Game &game, int16_t x, int16_t y, uint8_t &chr) {
     chr = '?';
@@ -892,21 +894,50 @@ void ZZT::ElementMove(Game &game, int16_t old_x, int16_t old_y, int16_t new_x, i
     }
 }
 
+static inline bool ElementPushableCanPush(Game &game, const Tile &tile, int16_t delta_x, int16_t delta_y) {
+    return (tile.element == ESliderNS && delta_x == 0)
+        || (tile.element == ESliderEW && delta_y == 0)
+        || game.elementDef(tile.element).pushable;
+}
+
+// OpenZoo: Resolved iteratively. Pushing is only ever attempted while walking
+// down the chain, and nothing changes on the board until its end has been
+// found, so the chain is measured first; the moves are then applied from the
+// far end back, as the original recursion unwinds.
 void ZZT::ElementPushablePush(Game &game, int16_t x, int16_t y, int16_t delta_x, int16_t delta_y) {
-    const Tile &from = game.board.tiles.get(x, y);
-    if ((from.element == ESliderNS && delta_x == 0)
-        || (from.element == ESliderEW && delta_y == 0)
-        || game.elementDef(from.element).pushable)
-    {
-        const Tile &to = game.board.tiles.get(x + delta_x, y + delta_y);
-        if (to.element == ETransporter) {
-            ElementTransporterMove(game, x, y, delta_x, delta_y);
-        } else if (to.element != EEmpty) {
-            // OpenZoo: Fix crashes based on an element recursively pushing itself.
-            if (delta_x != 0 || delta_y != 0) {
-                ElementPushablePush(game, x + delta_x, y + delta_y, delta_x, delta_y);
+    if (!ElementPushableCanPush(game, game.board.tiles.get(x, y), delta_x, delta_y)) {
+        return;
+    }
+
+    int16_t length = 1;
+    bool transporter = false;
+    // OpenZoo: Fix crashes based on an element recursively pushing itself.
+    if (delta_x != 0 || delta_y != 0) {
+        int16_t ix = x;
+        int16_t iy = y;
+        while (true) {
+            const Tile &to = game.board.tiles.get(ix + delta_x, iy + delta_y);
+            if (to.element == ETransporter) {
+                transporter = true;
+                break;
+            } else if (to.element == EEmpty || !ElementPushableCanPush(game, to, delta_x, delta_y)) {
+                break;
             }
+            ix += delta_x;
+            iy += delta_y;
+            length++;
         }
+    }
+
+    if (transporter) {
+        ElementTransporterMove(game, x + (length - 1) * delta_x, y + (length - 1) * delta_y, delta_x, delta_y);
+    }
+
+    for (int16_t i = length - 1; i >= 0; i--) {
+        int16_t ix = x + i * delta_x;
+        int16_t iy = y + i * delta_y;
+        const Tile &from = game.board.tiles.get(ix, iy);
+        const Tile &to = game.board.tiles.get(ix + delta_x, iy + delta_y);
 
 		if (game.engineDefinition.is<QUIRK_SUPER_ZZT_COMPAT_MISC>()) {
 			// TODO: What? Why?
@@ -914,22 +945,22 @@ void ZZT::ElementPushablePush(Game &game, int16_t x, int16_t y, int16_t delta_x,
 				&& game.elementDef(to.element).destructible
 				&& to.element != EPlayer)
 			{
-				game.BoardDamageTile(x + delta_x, y + delta_y);
+				game.BoardDamageTile(ix + delta_x, iy + delta_y);
 			}
 
 			if (to.element == EEmpty || ((from.element == EPlayer) && game.elementDef(to.element).walkable)) {
-				ElementMove(game, x, y, x + delta_x, y + delta_y);
+				ElementMove(game, ix, iy, ix + delta_x, iy + delta_y);
 			}
 		} else {
 			if (!game.elementDef(to.element).walkable
 				&& game.elementDef(to.element).destructible
 				&& to.element != EPlayer)
 			{
-				game.BoardDamageTile(x + delta_x, y + delta_y);
+				game.BoardDamageTile(ix + delta_x, iy + delta_y);
 			}
 
 			if (game.elementDef(to.element).walkable) {
-				ElementMove(game, x, y, x + delta_x, y + delta_y);
+				ElementMove(game, ix, iy, ix + delta_x, iy + delta_y);
 			}
 		}
     }
@@ -1028,8 +1059,10 @@ static void ElementDuplicatorTick(Game &game, int16_t stat_id) {
         const Tile &dest = game.board.tiles.get(dest_x, dest_y);
 
         if (dest.element == EPlayer) {
+            uint64_t profileStart = game.profiler.begin();
             game.elementDef(src.element)
                 .touch(game, src_x, src_y, 0, game.driver->deltaX, game.driver->deltaY);
+            game.profiler.end(ProfileTouch, src.element, profileStart);
         } else {
             if (dest.element != EEmpty) {
                 ElementPushablePush(game, dest_x, dest_y, -stat.step_x, -stat.step_y);
@@ -1057,7 +1090,7 @@ static void ElementDuplicatorTick(Game &game, int16_t stat_id) {
         game.BoardDrawTile(stat.x, stat.y);
     }
 
-    stat.cycle = (9 - stat.p2) * 3;
+    game.SetStatCycle(stat_id, (9 - stat.p2) * 3);
 }
 
 static void ElementScrollTick(Game &game, int16_t stat_id) {
@@ -1332,8 +1365,8 @@ static void ElementForestTouch(Game &game, int16_t x, int16_t y, int16_t source_
 	forestSound[1] = 1; // duration
 	forestSound[0] = 0x39; // note
 	if (game.engineDefinition.is<QUIRK_SUPER_ZZT_FOREST_SOUND>()) {
-		forestSound[0] = ForestSoundTable[ForestSoundTableIdx];
-		ForestSoundTableIdx = (ForestSoundTableIdx + 1) % sizeof(ForestSoundTable);
+		forestSound[0] = ForestSoundTable[game.forestSoundTableIdx];
+		game.forestSoundTableIdx = (game.forestSoundTableIdx + 1) % sizeof(ForestSoundTable);
 	}
 
 	game.driver->sound_queue(3, forestSound, 2);
@@ -1379,7 +1412,9 @@ static void ElementBoardEdgeTouch(Game &game, int16_t x, int16_t y, int16_t sour
     if (game.board.info.neighbor_boards[neighbor_board_id] != 0) {
         int16_t board_id = game.world.info.current_board;
         game.BoardChange(game.board.info.neighbor_boards[neighbor_board_id]);
-        if (game.board.tiles.get(entry_x, entry_y).element != EPlayer) {
+        uint8_t entry_element = game.board.tiles.get(entry_x, entry_y).element;
+        if (entry_element != EPlayer) {
+            uint64_t profileStart = game.profiler.begin();
             if (game.engineDefinition.is<QUIRK_BOARD_EDGE_TOUCH_DESINATION_FIX>()) {
                 game.elementDefAt(entry_x, entry_y).touch(game, entry_x, entry_y, source_stat_id,
                     delta_x, delta_y);
@@ -1387,6 +1422,7 @@ static void ElementBoardEdgeTouch(Game &game, int16_t x, int16_t y, int16_t sour
                 game.elementDefAt(entry_x, entry_y).touch(game, entry_x, entry_y, source_stat_id,
                     game.driver->deltaX, game.driver->deltaY);
             }
+            game.profiler.end(ProfileTouch, entry_element, profileStart);
         }
 
         const Tile &entryTile = game.board.tiles.get(entry_x, entry_y);
@@ -1432,14 +1468,13 @@ static void ElementSZZTLavaTouch(Game &game, int16_t x, int16_t y, int16_t sourc
 void Game::DrawPlayerSurroundings(int16_t x, int16_t y, int16_t bomb_phase) {
     int16_t torchDx = engineDefinition.torchDx;
     int16_t torchDy = engineDefinition.torchDy;
-    int16_t torchDistSqr = engineDefinition.torchDistSqr;
-    int16_t torchYMul = engineDefinition.is<QUIRK_SUPER_ZZT_COMPAT_MISC>() ? 1 : 2;
+    const TorchMask &torchMask = *engineDefinition.torchMask;
 
     for (int ix = (x - torchDx - 1); ix <= (x + torchDx + 1); ix++) {
         if (ix < 1 || ix > board.width()) continue;
         for (int iy = (y - torchDy - 1); iy <= (y + torchDy + 1); iy++) {
             if (iy < 1 || iy > board.height()) continue;
-            if (bomb_phase > 0 && (Sqr(ix - x) + Sqr(iy - y)*torchYMul) < torchDistSqr) {
+            if (bomb_phase > 0 && torchMask.lit(ix - x, iy - y)) {
                 const Tile &tile = board.tiles.get(ix, iy);
                 if (bomb_phase == 1) {
                     if (elementDef(tile.element).has_text()) {
@@ -1477,7 +1512,9 @@ void Game::GamePromptEndPlay(void) {
         BoardDrawBorder();
 		interface->GameHideMessage(*this);
     } else {
+        profiler.pause();
         gamePlayExitRequested = interface->SidebarPromptYesNo("End this game?", true);
+        profiler.resume();
         if (driver->keyPressed == KeyEscape) {
             gamePlayExitRequested = false;
         }
@@ -1506,8 +1543,11 @@ static void ElementApplyWaterMovement(Game &game, int16_t stat_id) {
 
     if (deltaX != 0 || deltaY != 0) {
         if (stat_id == 0) {
-            game.elementDefAt(stat.x + deltaX, stat.y + deltaY)
+            uint8_t element = game.board.tiles.get(stat.x + deltaX, stat.y + deltaY).element;
+            uint64_t profileStart = game.profiler.begin();
+            game.elementDef(element)
                 .touch(game, stat.x + deltaX, stat.y + deltaY, 0, deltaX, deltaY);
+            game.profiler.end(ProfileTouch, element, profileStart);
         }
 
         if (deltaX != 0 || deltaY != 0) {
@@ -1615,7 +1655,10 @@ static void ElementPlayerTick(Game &game, int16_t stat_id) {
 
         int16_t dest_x = stat.x + game.driver->deltaX;
         int16_t dest_y = stat.y + game.driver->deltaY;
-        game.elementDefAt(dest_x, dest_y).touch(game, dest_x, dest_y, 0, game.driver->deltaX, game.driver->deltaY);
+        uint8_t dest_element = game.board.tiles.get(dest_x, dest_y).element;
+        uint64_t profileStart = game.profiler.begin();
+        game.elementDef(dest_element).touch(game, dest_x, dest_y, 0, game.driver->deltaX, game.driver->deltaY);
+        game.profiler.end(ProfileTouch, dest_element, profileStart);
         if (game.driver->deltaX != 0 || game.driver->deltaY != 0) {
             // TODO [ZZT]: player walking sound
             if (game.elementDefAt(dest_x, dest_y).walkable) {
@@ -1674,8 +1717,16 @@ static void ElementPlayerTick(Game &game, int16_t stat_id) {
             game.GameUpdateSidebar();
             game.driver->keyPressed = ' ';
         } break;
+        case 'F': {
+            game.SetFastForward(game.fastForwardTicks > 0 ? 0 : FAST_FORWARD_DEFAULT_TICKS);
+        } break;
+        case 'R': {
+            game.rewindPending = SNAPSHOT_REWIND_TICKS;
+        } break;
         case 'H': {
+            game.profiler.pause();
             game.interface->DisplayFile(game.filesystem, "GAME.HLP", "Playing ZZT");
+            game.profiler.resume();
         } break;
 		case 'h': {
 			game.OopSend(0, "ALL:HINT", false);
@@ -1772,6 +1823,7 @@ void Game::InitEngine(EngineType engineType, bool is_editor) {
         this->engineDefinition.torchDx = 8;
         this->engineDefinition.torchDy = 8;
         this->engineDefinition.torchDistSqr = 64;
+        this->engineDefinition.torchMask = &TorchMaskSuperZZT;
         this->engineDefinition.textCutoff = 73;
 		this->engineDefinition.messageLines = 2;
 		this->engineDefinition.ammoPerAmmo = 10;
@@ -1798,6 +1850,7 @@ void Game::InitEngine(EngineType engineType, bool is_editor) {
         this->engineDefinition.torchDx = 8;
         this->engineDefinition.torchDy = 5;
         this->engineDefinition.torchDistSqr = 50;
+        this->engineDefinition.torchMask = &TorchMaskZZT;
         this->engineDefinition.textCutoff = 47;
 		this->engineDefinition.messageLines = 1;
 		this->engineDefinition.ammoPerAmmo = 5;
@@ -88,8 +88,8 @@ PosixIOStream::~PosixIOStream() {
     }
 }
 
-PosixFilesystemDriver::PosixFilesystemDriver()
-    : PathFilesystemDriver(nullptr, FILENAME_MAX, PATH_SEPARATOR, false) {
+PosixFilesystemDriver::PosixFilesystemDriver(bool read_only)
+    : PathFilesystemDriver(nullptr, FILENAME_MAX, PATH_SEPARATOR, read_only) {
     char *cwd_path = (char*) malloc(max_path_length + 1);
     getcwd(cwd_path, max_path_length);
     if (StrEmpty(cwd_path)) {
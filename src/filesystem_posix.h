@@ -25,7 +25,7 @@ namespace ZZT {
 
     class PosixFilesystemDriver: public PathFilesystemDriver {
     public:
-        PosixFilesystemDriver();
+        PosixFilesystemDriver(bool read_only = false);
 
         virtual IOStream *open_file_absolute(const char *filename, bool write) override;
         virtual bool list_files(std::function<bool(FileEntry&)> callback) override;
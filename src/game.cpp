@@ -1,8 +1,11 @@
 #include <cstdlib>
+#include <cstring>
 #include "editor.h"
 #include "file_selector.h"
 #include "gamevars.h"
 #include "platform_hacks.h"
+#include "replay.h"
+#include "trace.h"
 #include "txtwind.h"
 
 using namespace ZZT;
@@ -35,11 +38,16 @@ const uint8_t ZZT::WebChars[16] = {
 #if defined(__GBA__) || defined(__NDS__)
 extern uint8_t ext_tile_memory[];
 extern uint8_t ext_stat_memory[];
+
+// Only one tile map and stat list at a time - normally the current board's -
+// may use the fast memory; any others are allocated.
+static bool ext_tile_memory_used = false;
+static bool ext_stat_memory_used = false;
 #endif
 
 // LFSR11 for transition table
 
-static uint16_t transition_table_start = 42;
+static const uint16_t transition_table_start = 42;
 
 bool transition_table_next(uint16_t &seed, uint8_t &tx, uint8_t &ty) {
 	seed = (seed >> 1) ^ ((-(seed & 1)) & 0x740);
@@ -48,13 +56,17 @@ bool transition_table_next(uint16_t &seed, uint8_t &tx, uint8_t &ty) {
 	return (seed == transition_table_start);
 }
 
+// Number of cells handed to the driver at a time during transitions.
+#define TRANSITION_CHUNK_SIZE 128
+
 // TileMap
 
 TileMap::TileMap(uint8_t _width, uint8_t _height)
     : width(_width), height(_height) {
 #if defined(__GBA__) || defined(__NDS__)
-    if (width <= 60 && height <= 25) {
+    if (width <= 60 && height <= 25 && !ext_tile_memory_used) {
         this->tiles = (Tile*) ext_tile_memory;
+        ext_tile_memory_used = true;
     } else
 #endif
     this->tiles = (Tile*) malloc((width + 2) * (height + 2) * sizeof(Tile));
@@ -67,7 +79,9 @@ TileMap::TileMap(const TileMap&& other)
 
 TileMap::~TileMap() {
 #if defined(__GBA__) || defined(__NDS__)
-    if (width <= 60 && height <= 25) {} else
+    if (this->tiles == (Tile*) ext_tile_memory) {
+        ext_tile_memory_used = false;
+    } else
 #endif
     free(this->tiles);
 }
@@ -90,8 +104,9 @@ void TileMap::clear() {
 StatList::StatList(int16_t _size)
     : size(_size) {
 #if defined(__GBA__) || defined(__NDS__)
-    if (size <= 150) {
+    if (size <= 150 && !ext_stat_memory_used) {
         this->stats = (Stat*) ext_stat_memory;
+        ext_stat_memory_used = true;
     } else
 #endif
     this->stats = (Stat*) malloc((size + 3) * sizeof(Stat));
@@ -128,7 +143,9 @@ StatList::StatList(int16_t _size)
 StatList::~StatList() {
     free_all_data();
 #if defined(__GBA__) || defined(__NDS__)
-    if (size <= 150) {} else
+    if (this->stats == (Stat*) ext_stat_memory) {
+        ext_stat_memory_used = false;
+    } else
 #endif
     free(this->stats);
 }
@@ -144,6 +161,180 @@ void StatList::clear() {
 	this->stats[1].data.len = 0;
 }
 
+void StatList::detach_data(int16_t stat_id) {
+    if (!valid_input(stat_id)) return;
+    StatData &data = stats[stat_id + 1].data;
+    if (!data.is_shared()) return;
+
+    StatDataBuffer *buf = data.buffer();
+    uint16_t bound = 0;
+    for (int i = 0; i <= count; i++) {
+        if (stats[i + 1].data == data) bound++;
+    }
+    if (bound >= buf->refs) return;
+
+    StatDataBuffer *new_buf = (StatDataBuffer*) malloc(offsetof(StatDataBuffer, data) + data.len);
+    new_buf->refs = bound;
+    new_buf->in_arena = false;
+    new_buf->last_copy = data.copy;
+#ifdef LABEL_CACHE
+    new_buf->label_cache = nullptr;
+    new_buf->label_cache_len = -1;
+#endif
+    memcpy(new_buf->data, data.data, data.len);
+    buf->refs -= bound;
+
+    char *old_data = data.data;
+    uint32_t copy = data.copy;
+    for (int i = 0; i <= count; i++) {
+        StatData &other = stats[i + 1].data;
+        if (other.data == old_data && other.copy == copy) {
+            other.data = new_buf->data;
+        }
+    }
+}
+
+// StatScheduler
+
+// First tick at or after from_tick, in 1 .. MAX_TICK order, on which a stat
+// with this id and cycle is due; -1 if never. from_tick itself may be 0.
+static int16_t stat_next_due_tick(int16_t stat_id, int16_t cycle, int16_t from_tick) {
+    int16_t residue = stat_id % cycle;
+    int16_t tick = from_tick + ((residue - (from_tick % cycle) + cycle) % cycle);
+    if (tick <= MAX_TICK) {
+        return tick;
+    }
+    tick = (residue == 0) ? cycle : residue;
+    return (tick <= MAX_TICK) ? tick : -1;
+}
+
+static inline int16_t stat_cycle(const Stat &stat) {
+    // (currentTick % cycle) == (id % cycle) only depends on |cycle|
+    return (stat.cycle < 0) ? -stat.cycle : stat.cycle;
+}
+
+StatScheduler::StatScheduler() {
+    slot_head = (int16_t*) malloc(sizeof(int16_t) * STAT_SCHEDULER_SLOTS);
+    slot_next = nullptr;
+    due = nullptr;
+    size = 0;
+    due_len = 0;
+    due_pos = 0;
+    tick = -1;
+    invalidate();
+}
+
+StatScheduler::~StatScheduler() {
+    free(slot_head);
+    if (slot_next != nullptr) free(slot_next);
+    if (due != nullptr) free(due);
+}
+
+void StatScheduler::resize(int16_t stat_size) {
+    if (stat_size + 2 > size) {
+        if (slot_next != nullptr) free(slot_next);
+        if (due != nullptr) free(due);
+        size = stat_size + 2;
+        slot_next = (int16_t*) malloc(sizeof(int16_t) * size);
+        due = (int16_t*) malloc(sizeof(int16_t) * size);
+    }
+}
+
+void StatScheduler::invalidate(void) {
+    valid = false;
+    exact = false;
+}
+
+void StatScheduler::schedule(int16_t stat_id, int16_t cycle, int16_t from_tick) {
+    if (cycle == 0) return;
+    int16_t slot = stat_next_due_tick(stat_id, cycle, from_tick);
+    if (slot >= 0) {
+        slot_next[stat_id] = slot_head[slot];
+        slot_head[slot] = stat_id;
+    }
+}
+
+void StatScheduler::rebuild(StatList &stats) {
+    resize(stats.stat_size());
+    for (int i = 0; i < STAT_SCHEDULER_SLOTS; i++) {
+        slot_head[i] = -1;
+    }
+    // descending, so that slot lists come out ascending
+    for (int16_t i = stats.count; i >= 0; i--) {
+        schedule(i, stat_cycle(stats[i]), tick);
+    }
+    valid = true;
+}
+
+void StatScheduler::begin_tick(StatList &stats, int16_t new_tick) {
+    bool in_sequence = (new_tick == ((tick >= MAX_TICK) ? 1 : (tick + 1)));
+    tick = new_tick;
+    if (!valid || !in_sequence || due_pos < due_len) {
+        // also covers ticks abandoned halfway, as by pausing
+        rebuild(stats);
+    }
+
+    // Slot lists are built by prepending, mostly in ascending id order;
+    // reversing them first keeps the insertion sort close to linear.
+    due_len = 0;
+    for (int16_t i = slot_head[tick]; i >= 0; i = slot_next[i]) {
+        due[due_len++] = i;
+    }
+    slot_head[tick] = -1;
+    for (int16_t i = 0, j = due_len - 1; i < j; i++, j--) {
+        int16_t t = due[i]; due[i] = due[j]; due[j] = t;
+    }
+    for (int16_t i = 1; i < due_len; i++) {
+        int16_t id = due[i];
+        int16_t j = i - 1;
+        while (j >= 0 && due[j] > id) {
+            due[j + 1] = due[j];
+            j--;
+        }
+        due[j + 1] = id;
+    }
+    due_pos = 0;
+    exact = true;
+}
+
+void StatScheduler::stat_added(StatList &stats, int16_t stat_id) {
+    if (!valid) return;
+    int16_t cycle = stat_cycle(stats[stat_id]);
+    if (cycle == 0) return;
+    if (stat_next_due_tick(stat_id, cycle, tick) == tick) {
+        // the new stat has the highest id, so it goes last
+        due[due_len++] = stat_id;
+    } else {
+        schedule(stat_id, cycle, tick);
+    }
+}
+
+int16_t StatScheduler::next_due(StatList &stats, int16_t from) {
+    if (exact) {
+        if (due_pos >= due_len) {
+            return stats.count + 1;
+        }
+
+        int16_t stat_id = due[due_pos];
+        int16_t cycle = stat_cycle(stats[stat_id]);
+        if (stat_id >= from && stat_id <= stats.count && cycle != 0 && (tick % cycle) == (stat_id % cycle)) {
+            due_pos++;
+            schedule(stat_id, cycle, (tick >= MAX_TICK) ? 1 : (tick + 1));
+            return stat_id;
+        }
+        // changed behind our back; check every stat for the rest of the tick
+        invalidate();
+    }
+
+    for (int16_t i = from; i <= stats.count; i++) {
+        const Stat &stat = stats[i];
+        if (stat.cycle != 0 && ((tick % stat.cycle) == (i % stat.cycle))) {
+            return i;
+        }
+    }
+    return stats.count + 1;
+}
+
 // Board
 
 Board::Board(uint8_t width, uint8_t height, int16_t stat_size)
@@ -164,11 +355,14 @@ void Board::clear() {
 // World
 
 #define SERIALIZERS_COUNT 2
-static Serializer *serializers[SERIALIZERS_COUNT] = {
-    new SerializerFormatZZT(WorldFormatZZT),
-    new SerializerFormatZZT(WorldFormatSuperZZT)
+// Serializers hold no state, so all Game instances share them.
+static SerializerFormatZZT serializer_zzt(WorldFormatZZT);
+static SerializerFormatZZT serializer_super_zzt(WorldFormatSuperZZT);
+static Serializer *const serializers[SERIALIZERS_COUNT] = {
+    &serializer_zzt,
+    &serializer_super_zzt
 };
-static EngineType engine_types[SERIALIZERS_COUNT] = {
+static const EngineType engine_types[SERIALIZERS_COUNT] = {
     ENGINE_TYPE_ZZT,
     ENGINE_TYPE_SUPER_ZZT
 };
@@ -365,8 +559,20 @@ Game::Game(void):
     viewport(0, 0, 1, 1)
 {
 	interface = nullptr;
+	transitionOrder = nullptr;
+	transitionOrderWidth = 0;
+	transitionOrderHeight = 0;
+	transitionOrderLength = 0;
     tickSpeed = 4;
+    fastForwardTicks = 0;
+    fastForwardCounter = 0;
+    currentTick = 0;
+    currentStatTicked = 0;
+    boardDrawSuppressed = false;
+    rewindPending = 0;
+    forestSoundTableIdx = 0;
     debugEnabled = false;
+    gameStopRequested = false;
 #ifndef DISABLE_EDITOR
     editorEnabled = true;
 #endif
@@ -377,7 +583,9 @@ Game::Game(void):
 }
 
 Game::~Game() {
-	
+	if (transitionOrder != nullptr) {
+		free(transitionOrder);
+	}
 }
 
 void Game::Initialize() {
@@ -402,6 +610,9 @@ void Game::BoardClose() {
     world.write_board(world.info.current_board, board); 
 
     board.stats.free_all_data();
+    board.arena.clear();
+    soundPatternCache.clear();
+    statScheduler.invalidate();
 }
 
 void Game::BoardOpen(int16_t board_id) {
@@ -411,9 +622,13 @@ void Game::BoardOpen(int16_t board_id) {
 
     world.read_board(board_id, board);
     world.info.current_board = board_id;
+    soundPatternCache.clear();
+    statScheduler.invalidate();
 }
 
 void Game::BoardChange(int16_t board_id) {
+    TRACE_SCOPE_ID("BoardChange", board_id);
+
     board.tiles.set(board.stats[0].x, board.stats[0].y, {
         .element = EPlayer,
         .color = elementDef(EPlayer).color
@@ -424,6 +639,8 @@ void Game::BoardChange(int16_t board_id) {
 
 void Game::BoardCreate(void) {
 	board.clear();
+	soundPatternCache.clear();
+	statScheduler.invalidate();
 
     for (int ix = 1; ix <= board.width(); ix++) {
         board.tiles.set(ix, 1, TileBorder);
@@ -461,19 +678,53 @@ void Game::WorldCreate() {
     StrClear(loadedGameFileName);
 }
 
-void Game::TransitionDrawToFill(uint8_t chr, uint8_t color) {
+void Game::TransitionUpdateOrder(void) {
+	if (transitionOrder != nullptr
+		&& transitionOrderWidth == viewport.width
+		&& transitionOrderHeight == viewport.height) {
+		return;
+	}
+
+	if (transitionOrder != nullptr) {
+		free(transitionOrder);
+	}
+	transitionOrderWidth = viewport.width;
+	transitionOrderHeight = viewport.height;
+	transitionOrder = (Coord*) malloc(sizeof(Coord) * viewport.width * viewport.height);
+
 	uint16_t seed = transition_table_start;
 	uint8_t tx = transition_table_start - 1, ty = 0;
+	int i = 0;
 
 	do {
 		if (tx < viewport.width && ty < viewport.height) {
-			BoardDrawChar(
-				viewport.cx_offset + 1 + tx,
-				viewport.cy_offset + 1 + ty,
-				color, chr);
+			transitionOrder[i++] = {.x = tx, .y = ty};
 		}
 	} while (!transition_table_next(seed, tx, ty));
+	transitionOrderLength = i;
+}
+
+void Game::TransitionDrawToFill(uint8_t chr, uint8_t color) {
+	if (boardDrawSuppressed) {
+		return;
+	}
 
+	CharCell cells[TRANSITION_CHUNK_SIZE];
+	TransitionUpdateOrder();
+	int count = transitionOrderLength;
+
+	for (int i = 0; i < count; i += TRANSITION_CHUNK_SIZE) {
+		int chunk = (count - i) < TRANSITION_CHUNK_SIZE ? (count - i) : TRANSITION_CHUNK_SIZE;
+		for (int j = 0; j < chunk; j++) {
+			const Coord &pos = transitionOrder[i + j];
+			cells[j] = {
+				.x = (uint8_t) (viewport.x + pos.x), .y = (uint8_t) (viewport.y + pos.y),
+				.col = color, .chr = chr
+			};
+		}
+		driver->draw_char_batch(cells, chunk);
+		driver->idle(IMYield);
+	}
 }
 
 void Game::BoardRemoveTile(int16_t x, int16_t y) {
@@ -507,21 +758,14 @@ void Game::BoardRemoveTile(int16_t x, int16_t y) {
 }
 
 GBA_CODE_IWRAM
-void Game::BoardDrawTile(int16_t x, int16_t y) {
+void Game::BoardGetTileVisual(int16_t x, int16_t y, uint8_t &drawn_color, uint8_t &drawn_char) {
     Tile tile = board.tiles.get(x, y);
-    uint8_t drawn_char, drawn_color;
-    int x_pos = x - 1 - viewport.cx_offset;
-    int y_pos = y - 1 - viewport.cy_offset;
-    if (!(x_pos >= 0 && y_pos >= 0 && x_pos < viewport.width && y_pos < viewport.height)) {
-		return;
-    }
 
     if (!board.info.is_dark
         || elementDef(tile.element).visible_in_dark
         || (
             (world.info.torch_ticks > 0)
-            // TODO: torchYMul not implemented here as codepath not used in SZZT
-            && ((Sqr(board.stats[0].x - x) + Sqr(board.stats[0].y - y) * 2) < engineDefinition.torchDistSqr)
+            && engineDefinition.torchMask->lit(x - board.stats[0].x, y - board.stats[0].y)
         ) || forceDarknessOff
     ) {
         if (tile.element == EEmpty) {
@@ -529,7 +773,9 @@ void Game::BoardDrawTile(int16_t x, int16_t y) {
             drawn_char = ' ';
         } else if (elementDef(tile.element).has_draw_proc) {
             drawn_color = tile.color;
+            uint64_t profileStart = profiler.begin();
             elementDef(tile.element).draw(*this, x, y, drawn_char);
+            profiler.end(ProfileDraw, tile.element, profileStart);
         } else if (tile.element < engineDefinition.textCutoff) {
             drawn_color = tile.color;
             drawn_char = elementDef(tile.element).character;
@@ -548,7 +794,18 @@ void Game::BoardDrawTile(int16_t x, int16_t y) {
         drawn_color = 0x07;
         drawn_char = 176;
     }
+}
+
+GBA_CODE_IWRAM
+void Game::BoardDrawTile(int16_t x, int16_t y) {
+    uint8_t drawn_char, drawn_color;
+    int x_pos = x - 1 - viewport.cx_offset;
+    int y_pos = y - 1 - viewport.cy_offset;
+    if (boardDrawSuppressed || !(x_pos >= 0 && y_pos >= 0 && x_pos < viewport.width && y_pos < viewport.height)) {
+		return;
+    }
 
+    BoardGetTileVisual(x, y, drawn_color, drawn_char);
 	driver->draw_char(x_pos + viewport.x, y_pos + viewport.y, drawn_color, drawn_char);
 }
 
@@ -556,7 +813,7 @@ GBA_CODE_IWRAM
 void Game::BoardDrawChar(int16_t x, int16_t y, uint8_t drawn_color, uint8_t drawn_char) {
     int x_pos = x - 1 - viewport.cx_offset;
     int y_pos = y - 1 - viewport.cy_offset;
-    if (x_pos >= 0 && y_pos >= 0 && x_pos < viewport.width && y_pos < viewport.height) {
+    if (!boardDrawSuppressed && x_pos >= 0 && y_pos >= 0 && x_pos < viewport.width && y_pos < viewport.height) {
         driver->draw_char(x_pos + viewport.x, y_pos + viewport.y, drawn_color, drawn_char);
     }
 }
@@ -571,7 +828,7 @@ void Game::BoardScrollViewport(int16_t new_cx_offset, int16_t new_cy_offset) {
 	interface->GameHideMessage(*this);
 	viewport.cx_offset = new_cx_offset;
 	viewport.cy_offset = new_cy_offset;	
-	if ((Abs(deltaX) + Abs(deltaY)) == 1) {
+	if ((Abs(deltaX) + Abs(deltaY)) == 1 && !boardDrawSuppressed) {
 		driver->scroll_chars(viewport.x, viewport.y, viewport.width, viewport.height, deltaX, deltaY);
 		if (deltaX == 0) {
 			int y_pos = ((deltaY > 0) ? viewport.cy_offset : (viewport.cy_offset + viewport.height - 1)) + 1;
@@ -625,16 +882,101 @@ void Game::BoardDrawBorder(void) {
 }
 
 void Game::TransitionDrawToBoard(void) {
-	uint16_t seed = transition_table_start;
-	uint8_t tx = transition_table_start - 1, ty = 0;
+	if (boardDrawSuppressed) {
+		return;
+	}
 
-	do {
-		if (tx < viewport.width && ty < viewport.height) {
-			BoardDrawTile(
-				viewport.cx_offset + 1 + tx,
-				viewport.cy_offset + 1 + ty);
+	TRACE_SCOPE("TransitionDrawToBoard");
+
+	CharCell cells[TRANSITION_CHUNK_SIZE];
+	TransitionUpdateOrder();
+	int count = transitionOrderLength;
+
+	// Render the target image in board order first; the transition then
+	// only has to copy cells out of it.
+	uint8_t *image = (uint8_t*) malloc(viewport.width * viewport.height * 2);
+	if (image == nullptr) {
+		return;
+	}
+	for (int ty = 0; ty < viewport.height; ty++) {
+		uint8_t *row = image + (ty * viewport.width * 2);
+		for (int tx = 0; tx < viewport.width; tx++, row += 2) {
+			BoardGetTileVisual(viewport.cx_offset + 1 + tx, viewport.cy_offset + 1 + ty, row[0], row[1]);
 		}
-	} while (!transition_table_next(seed, tx, ty));
+	}
+
+	for (int i = 0; i < count; i += TRANSITION_CHUNK_SIZE) {
+		int chunk = (count - i) < TRANSITION_CHUNK_SIZE ? (count - i) : TRANSITION_CHUNK_SIZE;
+		for (int j = 0; j < chunk; j++) {
+			const Coord &pos = transitionOrder[i + j];
+			const uint8_t *cell = image + ((pos.y * viewport.width + pos.x) * 2);
+			cells[j] = {
+				.x = (uint8_t) (viewport.x + pos.x), .y = (uint8_t) (viewport.y + pos.y),
+				.col = cell[0], .chr = cell[1]
+			};
+		}
+		driver->draw_char_batch(cells, chunk);
+		driver->idle(IMYield);
+	}
+
+	free(image);
+}
+
+// Redraw the whole viewport from board state at once, without a transition.
+void Game::BoardDrawViewport(void) {
+	CharCell cells[TRANSITION_CHUNK_SIZE];
+	int chunk = 0;
+
+	for (int ty = 0; ty < viewport.height; ty++) {
+		for (int tx = 0; tx < viewport.width; tx++) {
+			CharCell &cell = cells[chunk++];
+			cell.x = viewport.x + tx;
+			cell.y = viewport.y + ty;
+			BoardGetTileVisual(viewport.cx_offset + 1 + tx, viewport.cy_offset + 1 + ty, cell.col, cell.chr);
+			if (chunk == TRANSITION_CHUNK_SIZE) {
+				driver->draw_char_batch(cells, chunk);
+				chunk = 0;
+			}
+		}
+	}
+	if (chunk > 0) {
+		driver->draw_char_batch(cells, chunk);
+	}
+}
+
+// Bring the screen back in line with the board after fast-forwarded ticks.
+void Game::FastForwardPresent(void) {
+	boardDrawSuppressed = false;
+	BoardDrawViewport();
+	interface->GameShowMessage(*this, 0);
+}
+
+void Game::SetFastForward(int16_t ticks_per_frame) {
+	fastForwardTicks = ticks_per_frame > 0 ? ticks_per_frame : 0;
+	fastForwardCounter = 0;
+	if (fastForwardTicks == 0 && boardDrawSuppressed) {
+		FastForwardPresent();
+	}
+}
+
+// Rewinds the game by up to the given number of ticks; call between ticks.
+bool Game::RewindSnapshots(int16_t ticks) {
+	if (ticks > snapshots.size()) {
+		ticks = snapshots.size();
+	}
+	if (ticks <= 0 || !snapshots.restore(*this, ticks - 1)) {
+		return false;
+	}
+
+	soundPatternCache.clear();
+	statScheduler.invalidate();
+	currentStatTicked = board.stats.count + 1;
+
+	BoardUpdateDrawOffset();
+	boardDrawSuppressed = false;
+	BoardDrawViewport();
+	GameUpdateSidebar();
+	return true;
 }
 
 void Game::SidebarPromptCharacter(bool editable, int16_t x, int16_t y, const char *prompt, uint8_t &value) {
@@ -790,9 +1132,11 @@ void Game::DisplayIOError(IOStream &stream) {
     window->Append("using a blank, formatted disk");
     window->Append("for saving the game!");
 
+    profiler.pause();
     window->DrawOpen();
     window->Select(false, false);
     window->DrawClose();
+    profiler.resume();
 	
 	delete window;
 }
@@ -800,12 +1144,17 @@ void Game::DisplayIOError(IOStream &stream) {
 void Game::WorldUnload(void) {
 	// OpenZoo: Full BoardClose() is unnecessary here
     board.stats.free_all_data();
+    board.arena.clear();
+    soundPatternCache.clear();
+    snapshots.clear();
     for (int i = 0; i <= world.board_count; i++) {
         world.free_board(i);
     }
 }
 
 bool Game::WorldLoad(const char *filename, const char *extension, bool titleOnly, bool showError) {
+    TRACE_SCOPE("WorldLoad");
+
     interface->SidebarShowMessage(0x0F, " Loading.....", true);
 
     sstring<31> ext_tokens;
@@ -839,6 +1188,9 @@ bool Game::WorldLoad(const char *filename, const char *extension, bool titleOnly
         if (result) {
             BoardOpen(world.info.current_board);
             StrCopy(loadedGameFileName, filename);
+            if (driver->recorder != nullptr) {
+                driver->recorder->record_world(*this, filename);
+            }
             interface->SidebarHideMessage();
             delete stream;
             return true;
@@ -858,6 +1210,8 @@ bool Game::WorldLoad(const char *filename, const char *extension, bool titleOnly
 }
 
 bool Game::WorldSave(const char *filename, const char *extension) {
+    TRACE_SCOPE("WorldSave");
+
     BoardClose();
     interface->SidebarShowMessage(0x0F, " Saving...", true);
 
@@ -890,7 +1244,9 @@ bool Game::WorldSave(const char *filename, const char *extension) {
 void Game::GameWorldSave(const char *prompt, char* filename, size_t filename_len, const char *extension) {
     sstring<50> newFilename;
     StrCopy(newFilename, filename);
+    profiler.pause();
     interface->SidebarPromptString(prompt, extension, newFilename, sizeof(newFilename), InputPMAlphanumeric);
+    profiler.resume();
     if (driver->keyPressed != KeyEscape && !StrEmpty(newFilename)) {
         strncpy(filename, newFilename, filename_len - 1);
         filename[filename_len - 1] = 0;
@@ -927,22 +1283,20 @@ bool Game::GameWorldLoad(const char *extension) {
 }
 
 void ZZT::CopyStatDataToTextWindow(const Stat &stat, TextWindow &window) {
-    DynString s = "";
-    
+    const char *data = stat.data.data;
+    const char *end = data + stat.data.len;
+
     window.Clear();
 
-    for (int i = 0; i < stat.data.len; i++) {
-        char ch = stat.data.data[i];
-        if (ch == '\r') {
-            window.Append(s);
-            s = "";
-        } else {
-            s = s + ch;
+    // lines are appended straight from the program buffer
+    while (data < end) {
+        const char *cr = (const char*) memchr(data, '\r', end - data);
+        if (cr == nullptr) {
+            window.Append(data, end - data);
+            break;
         }
-    }
-
-    if (s.length() > 0) {
-        window.Append(s);
+        window.Append(data, cr - data);
+        data = cr + 1;
     }
 }
 
@@ -958,6 +1312,7 @@ void Game::AddStat(int16_t x, int16_t y, uint8_t element, uint8_t color, int16_t
         stat.under = board.tiles.get(x, y);
         stat.data.duplicate();
         stat.data_pos = 0;
+        statScheduler.stat_added(board.stats, board.stats.count);
 
         board.tiles.set(x, y, {
             .element = element,
@@ -974,6 +1329,9 @@ void Game::AddStat(int16_t x, int16_t y, uint8_t element, uint8_t color, int16_t
 
 void Game::RemoveStat(int16_t stat_id) {
     Stat& stat = board.stats[stat_id];
+    if (!stat.data.is_shared()) {
+        soundPatternCache.invalidate(stat.data.data);
+    }
     board.stats.free_data_if_unused(stat_id);
 
     if (stat_id < currentStatTicked) {
@@ -1001,6 +1359,7 @@ void Game::RemoveStat(int16_t stat_id) {
         board.stats[i - 1] = board.stats[i];
     }
     board.stats.count--;
+    statScheduler.invalidate();
 }
 
 bool Game::BoardPrepareTileForPlacement(int16_t x, int16_t y) {
@@ -1022,6 +1381,14 @@ bool Game::BoardPrepareTileForPlacement(int16_t x, int16_t y) {
     return result;
 }
 
+void Game::SetStatCycle(int16_t stat_id, int16_t cycle) {
+    Stat& stat = board.stats[stat_id];
+    if (stat.cycle != cycle) {
+        stat.cycle = cycle;
+        statScheduler.invalidate();
+    }
+}
+
 void Game::MoveStat(int16_t stat_id, int16_t newX, int16_t newY, bool scrollOffset) {
     Stat& stat = board.stats[stat_id];
     
@@ -1137,19 +1504,34 @@ void Game::MoveStat(int16_t stat_id, int16_t newX, int16_t newY, bool scrollOffs
 
     if (stat_id == 0 && board.info.is_dark && world.info.torch_ticks > 0) {
         if (!scrolled && ((Sqr(oldX - stat.x) + Sqr(oldY - stat.y)) == 1)) {
-            int16_t torchDx = engineDefinition.torchDx;
-            int16_t torchDy = engineDefinition.torchDy;
-            int16_t torchDistSqr = engineDefinition.torchDistSqr;
-            int16_t torchYMul = engineDefinition.is<QUIRK_SUPER_ZZT_COMPAT_MISC>() ? 1 : 2;
-
-            for (int ix = (stat.x - torchDx - 3); ix <= (stat.x + torchDx + 3); ix++) {
-                if (ix < 1 || ix > board.width()) continue;
-                for (int iy = (stat.y - torchDy - 3); iy <= (stat.y + torchDy + 3); iy++) {
-                    if (iy < 1 || iy > board.height()) continue;
-                    if ((((Sqr(ix-oldX))+(Sqr(iy-oldY)*torchYMul)) < torchDistSqr) !=
-                        (((Sqr(ix-newX))+(Sqr(iy-newY)*torchYMul)) < torchDistSqr))
-                    {
-                        BoardDrawTile(ix, iy);
+            // Unit move: only the edges of the lit area change. Row extents
+            // come from the precomputed mask, so no per-cell distance checks.
+            const TorchMask &torchMask = *engineDefinition.torchMask;
+            int16_t mx = newX - oldX;
+            int16_t my = newY - oldY;
+
+            auto redraw = [&](int16_t ix, int16_t iy) {
+                if (ix >= 1 && ix <= board.width()) {
+                    BoardDrawTile(ix, iy);
+                }
+            };
+
+            for (int16_t dy = -TORCH_MASK_MAX_DY - 1; dy <= TORCH_MASK_MAX_DY + 1; dy++) {
+                int16_t iy = newY + dy;
+                if (iy < 1 || iy > board.height()) continue;
+                int16_t extNew = torchMask.row(dy);
+                if (my == 0) {
+                    if (extNew >= 0) {
+                        redraw(newX + mx * extNew, iy);
+                        redraw(oldX - mx * extNew, iy);
+                    }
+                } else {
+                    int16_t extOld = torchMask.row(dy + my);
+                    int16_t extMin = extNew < extOld ? extNew : extOld;
+                    int16_t extMax = extNew < extOld ? extOld : extNew;
+                    for (int16_t e = extMin + 1; e <= extMax; e++) {
+                        redraw(newX - e, iy);
+                        redraw(newX + e, iy);
                     }
                 }
             }
@@ -1176,6 +1558,14 @@ static const char * menu_str_sound(Game *game) {
     return game->driver->sound_is_enabled() ? "Be quiet" : "Be noisy";
 }
 
+static const char * menu_str_fastForward(Game *game) {
+    return game->fastForwardTicks > 0 ? "Normal speed" : "Fast forward";
+}
+
+static const char * menu_str_rewind(Game *game) {
+    return game->debugEnabled ? "Rewind" : nullptr;
+}
+
 static const char * menu_str_editor(Game *game) {
     return game->editorEnabled ? "Editor" : nullptr;
 }
@@ -1418,7 +1808,9 @@ void Game::GameDebugPrompt(void) {
     sstring<50> input;
     StrClear(input);
 
+    profiler.pause();
     interface->SidebarPromptString(nullptr, nullptr, input, StrSize(input), InputPMAnyText);
+    profiler.resume();
     for (size_t i = 0; i < strlen(input); i++) {
         input[i] = UpCase(input[i]);
     }
@@ -1435,6 +1827,9 @@ void Game::GameDebugPrompt(void) {
     }
 
     debugEnabled = WorldGetFlagPosition("DEBUG") >= 0;
+    if (debugEnabled && snapshots.get_capacity() == 0) {
+        snapshots.set_capacity(SNAPSHOT_DEBUG_CAPACITY);
+    }
 
     if (StrEquals(input, "HEALTH")) {
         world.info.health += 50;
@@ -1459,6 +1854,28 @@ void Game::GameDebugPrompt(void) {
             board.tiles.set_element(dest_x, dest_y, EEmpty);
             BoardDrawTile(dest_x, dest_y);
         }
+    } else if (StrEquals(input, "PROFILE")) {
+        // OpenZoo: PROFILE starts the tick profiler, or shows its report once
+        // running; -PROFILE stops it and discards the data.
+        if (!toggle) {
+            profiler.clear();
+        } else if (!profiler.is_active()) {
+            profiler.start();
+        } else {
+            profiler.pause();
+            TextWindow *window = interface->CreateTextWindow(filesystem);
+            StrCopy(window->title, "Profile");
+            profiler.report(*this, [window](const char *line) {
+                window->Append(line);
+            });
+
+            window->DrawOpen();
+            window->Select(false, false);
+            window->DrawClose();
+            profiler.resume();
+
+            delete window;
+        }
     }
 
 	driver->sound_queue(10, "\x27\x04");
@@ -1517,6 +1934,10 @@ void Game::GamePlayLoop(bool boardChanged) {
 
     do {
         if (gamePaused) {
+            if (boardDrawSuppressed) {
+                FastForwardPresent();
+            }
+
             if (HasTimeElapsed(tickTimeCounter, 25)) {
                 pauseBlink = !pauseBlink;
             }
@@ -1543,7 +1964,10 @@ void Game::GamePlayLoop(bool boardChanged) {
             if (driver->deltaX != 0 || driver->deltaY != 0) {
                 int16_t dest_x = player.x + driver->deltaX;
                 int16_t dest_y = player.y + driver->deltaY;
-                elementDefAt(dest_x, dest_y).touch(*this, dest_x, dest_y, 0, driver->deltaX, driver->deltaY);
+                uint8_t element = board.tiles.get(dest_x, dest_y).element;
+                uint64_t profileStart = profiler.begin();
+                elementDef(element).touch(*this, dest_x, dest_y, 0, driver->deltaX, driver->deltaY);
+                profiler.end(ProfileTouch, element, profileStart);
             }
 
             if (driver->deltaX != 0 || driver->deltaY != 0) {
@@ -1583,12 +2007,18 @@ void Game::GamePlayLoop(bool boardChanged) {
             }
         } else /* not gamePaused */ {
             if (currentStatTicked <= board.stats.count) {
-                Stat &stat = board.stats[currentStatTicked];
-                if (stat.cycle != 0 && ((currentTick % stat.cycle) == (currentStatTicked % stat.cycle))) {
-                    elementDefAt(stat.x, stat.y).tick(*this, currentStatTicked);
+                currentStatTicked = statScheduler.next_due(board.stats, currentStatTicked);
+                if (currentStatTicked <= board.stats.count) {
+                    Stat &stat = board.stats[currentStatTicked];
+                    uint8_t element = board.tiles.get(stat.x, stat.y).element;
+                    uint64_t profileStart = profiler.begin();
+                    elementDef(element).tick(*this, currentStatTicked);
+                    profiler.end(ProfileTick, element, profileStart);
+                    currentStatTicked++;
+                }
+                if (currentStatTicked > board.stats.count) {
+                    TRACE_END();
                 }
-
-                currentStatTicked++;
             }
         }
 
@@ -1597,19 +2027,53 @@ void Game::GamePlayLoop(bool boardChanged) {
 #ifdef __GBA__
 			gba_on_tick_end();
 #endif
-            if (HasTimeElapsed(tickTimeCounter, tickTimeDuration)) {
+            // OpenZoo: Fast-forward runs ticks back to back, suppressing board
+            // drawing in between and presenting one frame per fastForwardTicks ticks.
+            bool fastForward = fastForwardTicks > 0 && world.info.health > 0;
+            if (fastForward || HasTimeElapsed(tickTimeCounter, tickTimeDuration)) {
 #ifdef __GBA__
 				gba_on_tick_start();
 #endif
+                // OpenZoo: Snapshots are taken, and rewinds applied, between ticks.
+                profiler.tick_done();
+                if (rewindPending > 0) {
+                    RewindSnapshots(rewindPending);
+                    rewindPending = 0;
+                } else if (snapshots.get_capacity() > 0) {
+                    snapshots.capture(*this);
+                }
+                if (driver->recorder != nullptr) {
+                    driver->recorder->record_tick(*this);
+                }
+                driver->on_game_tick(*this);
                 currentTick++;
-                if (currentTick > 420) {
+                if (currentTick > MAX_TICK) {
                     currentTick = 1;
                 }
                 currentStatTicked = 0;
+                statScheduler.begin_tick(board.stats, currentTick);
+                // A tick's trace span ends once its last stat has been ticked
+                // (or here, if it was interrupted by pausing).
+                TRACE_END();
+                TRACE_BEGIN_ID("tick", currentTick);
+
+                if (fastForward) {
+                    if (++fastForwardCounter >= fastForwardTicks) {
+                        fastForwardCounter = 0;
+                        if (boardDrawSuppressed) {
+                            FastForwardPresent();
+                        }
+                        driver->idle(IMYield);
+                    }
+                    boardDrawSuppressed = fastForwardTicks > 1;
+                } else if (boardDrawSuppressed) {
+                    FastForwardPresent();
+                }
 
                 // OpenZoo: On some platforms, it is necessary to occasionally yield,
                 // which will not happen with a zero tick time duration otherwise.
-                if (tickTimeDuration == 0) {
+                // (Fast-forward yields once per presented frame instead.)
+                if (!fastForward && tickTimeDuration == 0) {
                     if (world.info.health <= 0) {
                         // The game over state certainly shouldn't consume 100% CPU.
                         // Pinning to VBlank should be sufficient to give the necessary "feel"
@@ -1627,8 +2091,11 @@ void Game::GamePlayLoop(bool boardChanged) {
                 driver->idle(IMUntilPit);
             }
         }
-    } while (!((exitLoop || gamePlayExitRequested) && gamePlayExitRequested));
+    } while (!((exitLoop || gamePlayExitRequested) && gamePlayExitRequested) && !gameStopRequested);
 
+    if (boardDrawSuppressed) {
+        FastForwardPresent();
+    }
     driver->sound_clear_queue();
 
     if (gameStateElement == EPlayer) {
@@ -1678,6 +2145,8 @@ const MenuEntry ZZT::PlayMenu[] = {
     {.id = 'H', .keys = {'H'}, .name = "Help"},
     {.id = '?', .keys = {'?'}, .name = "Console command"},
     {.id = 'B', .keys = {'B'}, .name_func = menu_str_sound},
+    {.id = 'F', .keys = {KeyTab}, .name_func = menu_str_fastForward},
+    {.id = 'R', .keys = {KeyBackspace}, .name_func = menu_str_rewind},
 #ifdef __GBA__
 	{.id = 255, .name = "Sleep"},
 #endif
@@ -1782,7 +2251,7 @@ void Game::GameTitleLoop(void) {
                 GamePlayLoop(true);
                 boardChanged = true;
             }
-        } while (!boardChanged && !gameTitleExitRequested);
+        } while (!boardChanged && !gameTitleExitRequested && !gameStopRequested);
 		delete interface;
-    } while (!gameTitleExitRequested);
+    } while (!gameTitleExitRequested && !gameStopRequested);
 }
@@ -4,6 +4,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <cstdlib> // TODO
+#include "utils/arena.h"
 #include "utils/iostream.h"
 #include "utils/mathutils.h"
 #include "utils/quirkset.h"
@@ -11,6 +12,8 @@
 #include "utils/tokenmap.h"
 #include "filesystem.h"
 #include "driver.h"
+#include "profiler.h"
+#include "snapshot.h"
 #include "sounds.h"
 #include "txtwind.h"
 #include "high_scores.h"
@@ -20,6 +23,10 @@
 #define MAX_ELEMENT 80
 #define MAX_FLAG 16
 #define MAX_MESSAGE_LINES 2
+#define MAX_TICK 420
+#define STAT_SCHEDULER_SLOTS (MAX_TICK + 1)
+#define FAST_FORWARD_DEFAULT_TICKS 16
+#define TORCH_MASK_MAX_DY 8
 
 namespace ZZT {
     typedef enum : uint8_t {
@@ -123,90 +130,147 @@ namespace ZZT {
         Tile tile;
     };
 
+    // Program text, shared by reference between the stats which use it.
+    // Stats bound together (#bind) share one program; copies of a stat
+    // (AddStat) only share its text, until either of them writes to it.
+    struct StatDataBuffer {
+        uint16_t refs;
+        bool in_arena; // released along with the arena
+        uint32_t last_copy;
+#ifdef LABEL_CACHE
+		int16_t *label_cache;
+		int16_t label_cache_len;
+#endif
+        char data[1];
+    };
+
     class StatData {
+        friend class StatList;
+
+        // tells apart copies sharing a buffer
+        uint32_t copy = 0;
+
     public:
 #ifdef ROM_POINTERS
         const char *data_rom = nullptr;
 #endif
+        // read only while the buffer is shared; see StatList::detach_data
         char *data = nullptr;
-#ifdef LABEL_CACHE
-		int16_t *label_cache = nullptr;
-		int16_t label_cache_len = -1;
-#endif
 	    int16_t len = 0;
     
         StatData() = default;
 
         inline bool operator==(const StatData &b) const {
-            return data == b.data;
+            return data == b.data && copy == b.copy;
         }
 
         inline bool operator!=(const StatData &b) const {
-            return data != b.data;
+            return data != b.data || copy != b.copy;
+        }
+
+        inline StatDataBuffer *buffer() const {
+            return (data != nullptr && len > 0)
+                ? (StatDataBuffer*) (data - offsetof(StatDataBuffer, data))
+                : nullptr;
+        }
+
+        inline bool is_shared() const {
+            StatDataBuffer *buf = buffer();
+            return buf != nullptr && buf->refs > 1;
         }
 
 #ifdef LABEL_CACHE
 		inline void build_label_cache() {
-			if (label_cache_len < 0 && len > 0) {
-				label_cache = nullptr;
-				label_cache_len = 0;
+			StatDataBuffer *buf = buffer();
+			if (buf != nullptr && buf->label_cache_len < 0) {
+				buf->label_cache = nullptr;
+				buf->label_cache_len = 0;
 				for (int i = 0; i < len-1; i++) {
 					if (data[i] == '\r' && (data[i+1] == '\'' || data[i+1] == ':' || i <= 1)) {
-						label_cache_len++;
+						buf->label_cache_len++;
 					}
 				}
-				if (label_cache_len > 0) {
-					label_cache = (int16_t*) malloc(sizeof(int16_t) * label_cache_len);
+				if (buf->label_cache_len > 0) {
+					buf->label_cache = (int16_t*) malloc(sizeof(int16_t) * buf->label_cache_len);
 					int16_t j = 0;
 					for (int i = 0; i < len-1; i++) {
 						if (data[i] == '\r' && (data[i+1] == '\'' || data[i+1] == ':' || i <= 1)) {
-							label_cache[j++] = i;
-							if (j == label_cache_len) break;
+							buf->label_cache[j++] = i;
+							if (j == buf->label_cache_len) break;
 						}
 					}
 				}
 			}
 		}
+
+		inline const int16_t *label_cache() const {
+			StatDataBuffer *buf = buffer();
+			return buf != nullptr ? buf->label_cache : nullptr;
+		}
+
+		inline int16_t label_cache_len() const {
+			StatDataBuffer *buf = buffer();
+			return buf != nullptr ? buf->label_cache_len : 0;
+		}
 #endif
 
+        // A copy of the program, for a new stat: shares the text.
         inline void duplicate() {
-            if (data != nullptr && len > 0) {
-                char *new_data = (char*) malloc(len);
-                memcpy(new_data, data, len);
-                data = new_data;
+            StatDataBuffer *buf = buffer();
+            if (buf != nullptr) {
+                buf->refs++;
+                copy = ++buf->last_copy;
+            }
+        }
 
-#ifdef LABEL_CACHE
-				label_cache = nullptr;
-				label_cache_len = -1;
-#endif
+        // The same program as other's, as with #bind. Any program held
+        // before is not released.
+        inline void bind(const StatData &other) {
+            StatDataBuffer *buf = other.buffer();
+            if (buf != nullptr) {
+                buf->refs++;
             }
+            *this = other;
         }
 
         inline void clear_data() {
             data = nullptr;
             len = 0;
-
-#ifdef LABEL_CACHE
-			label_cache = nullptr;
-			label_cache_len = -1;
-#endif
+            copy = 0;
         }
 
         inline void free_data() {
-            if (data != nullptr && len > 0) {
-                free(data);
+            StatDataBuffer *buf = buffer();
+            if (buf != nullptr) {
+                if (--buf->refs == 0) {
 #ifdef LABEL_CACHE
-				if (label_cache != nullptr && label_cache_len > 0) free(label_cache);
+					if (buf->label_cache != nullptr) free(buf->label_cache);
 #endif
+                    if (!buf->in_arena) free(buf);
+                }
                 clear_data();
             }
         }
 
-        inline void alloc_data(int16_t length) {
+        // An arena, if given, must outlive every stat sharing the program.
+        inline void alloc_data(int16_t length, Arena *arena = nullptr) {
 			clear_data();
 			len = length;
 			if (len > 0) {
-				data = (char*) malloc(len);
+				size_t size = offsetof(StatDataBuffer, data) + len;
+				StatDataBuffer *buf = arena != nullptr ? (StatDataBuffer*) arena->alloc(size) : nullptr;
+				bool in_arena = buf != nullptr;
+				if (!in_arena) {
+					buf = (StatDataBuffer*) malloc(size);
+				}
+				buf->refs = 1;
+				buf->in_arena = in_arena;
+				buf->last_copy = 0;
+#ifdef LABEL_CACHE
+				buf->label_cache = nullptr;
+				buf->label_cache_len = -1;
+#endif
+				data = buf->data;
 			}
         }
     };
@@ -295,6 +359,11 @@ namespace ZZT {
                 tiles[x * (height + 2) + y].color = color;
             }
         }
+
+        // raw tile plane, for snapshots
+        Tile *data() { return tiles; }
+        const Tile *data() const { return tiles; }
+        int32_t data_size() const { return (width + 2) * (height + 2); }
     };
 
     class StatList {
@@ -351,38 +420,48 @@ namespace ZZT {
 
         void free_data_if_unused(int16_t stat_id) {
             if (!valid_input(stat_id)) return;
-            Stat &stat = stats[stat_id + 1];
-            if (stat.data.len != 0) {
-                bool found = false;
-                for (int i = 0; i <= count; i++) {
-                    if (i == stat_id) continue;
-                    if (stats[i + 1].data == stat.data) {
-                        found = true;
-                        break;
-                    }
-                }
-                if (found) {
-                    stat.data.clear_data();
-                } else {
-                    stat.data.free_data();
-                }
-            }
+            stats[stat_id + 1].data.free_data();
         }
 
         void free_all_data() {
             for (int i = 0; i <= count; i++) {
-                Stat &stat = stats[i + 1];
-                if (stat.data.len > 0) {
-                    for (int j = i + 1; j <= count; j++) {
-                        Stat &stat2 = stats[j + 1];
-                        if (stat.data == stat2.data) {
-                            stat2.data.clear_data();
-                        }
-                    }
-                    stat.data.free_data();
-                }
+                stats[i + 1].data.free_data();
             }
         }
+
+        // Gives the stat's program a buffer of its own before it is written
+        // to, unless only the stat and the stats bound to it hold it.
+        void detach_data(int16_t stat_id);
+    };
+
+    // GamePlayLoop ticks a stat when (currentTick % cycle) == (id % cycle),
+    // with currentTick running 1 .. 420. The scheduler keeps every stat in a
+    // wheel slot for the next tick it is due on, so that only those stats are
+    // visited. AddStat is tracked directly; other changes to stat ids or
+    // cycles invalidate it, and every stat is checked until the next tick.
+    class StatScheduler {
+        int16_t *slot_head; // [STAT_SCHEDULER_SLOTS], linked through slot_next
+        int16_t *slot_next;
+        int16_t *due; // stat ids due this tick, ascending
+        int16_t size;
+        int16_t due_len, due_pos;
+        int16_t tick;
+        bool valid; // slots are up to date
+        bool exact; // due list is up to date
+
+        void resize(int16_t stat_size);
+        void rebuild(StatList &stats);
+        void schedule(int16_t stat_id, int16_t cycle, int16_t from_tick);
+
+    public:
+        StatScheduler();
+        ~StatScheduler();
+
+        void invalidate(void);
+        void begin_tick(StatList &stats, int16_t tick);
+        void stat_added(StatList &stats, int16_t stat_id);
+        // first stat id >= from due this tick, or stats.count + 1
+        int16_t next_due(StatList &stats, int16_t from);
     };
 
     class Board {
@@ -392,6 +471,9 @@ namespace ZZT {
 
         sstring<60> name;
         TileMap tiles;
+        // Code of the stats as loaded; cleared once they are freed on
+        // closing the board.
+        Arena arena;
         StatList stats;
         BoardInfo info;
 
@@ -655,9 +737,34 @@ namespace ZZT {
         QUIRK_SUPER_ZZT_MESSAGES, // Super ZZT
         QUIRK_SUPER_ZZT_STONES_OF_POWER, // Super ZZT - affects OOP #GIVE/#TAKE
         QUIRK_SUPER_ZZT_COMPAT_MISC, // Super ZZT - assorted
-        EngineQuirkCount  
+        EngineQuirkCount
+    };
+
+    // Lit region of a torch (also used for bomb blasts), relative to its center.
+    // extent[dy + TORCH_MASK_MAX_DY] is the largest |dx| lit on row dy, or -1 if none.
+    struct TorchMask {
+        int8_t extent[TORCH_MASK_MAX_DY * 2 + 1];
+
+        inline int8_t row(int16_t dy) const {
+            return (dy < -TORCH_MASK_MAX_DY || dy > TORCH_MASK_MAX_DY) ? -1 : extent[dy + TORCH_MASK_MAX_DY];
+        }
+
+        inline bool lit(int16_t dx, int16_t dy) const {
+            return Abs(dx) <= row(dy);
+        }
     };
 
+    // (dx^2 + dy^2 * y_mul) < dist_sqr
+    constexpr TorchMask TorchMaskCreate(int16_t dist_sqr, int16_t y_mul) {
+        TorchMask mask = {};
+        for (int dy = -TORCH_MASK_MAX_DY; dy <= TORCH_MASK_MAX_DY; dy++) {
+            int dx = -1;
+            while (((dx + 1) * (dx + 1) + dy * dy * y_mul) < dist_sqr) dx++;
+            mask.extent[dy + TORCH_MASK_MAX_DY] = dx;
+        }
+        return mask;
+    }
+
     class Viewport {
     public:
         int16_t cx_offset, cy_offset, x, y, width, height;
@@ -693,6 +800,7 @@ namespace ZZT {
 		uint8_t messageLines;
         int16_t torchDuration, torchDistSqr;
         int16_t torchDx, torchDy;
+        const TorchMask *torchMask;
         int16_t boardWidth, boardHeight, statCount;
 		int16_t flagCount;
 		int16_t ammoPerAmmo;
@@ -754,8 +862,15 @@ namespace ZZT {
     private:
         bool initialized;
 
+		// transition order, cached per viewport size
+		Coord *transitionOrder;
+		uint8_t transitionOrderWidth, transitionOrderHeight;
+		int16_t transitionOrderLength;
+
 		// game.cpp
 		void BoardScrollViewport(int16_t new_cx_offset, int16_t new_cy_offset);
+		void BoardGetTileVisual(int16_t x, int16_t y, uint8_t &drawn_color, uint8_t &drawn_char);
+		void TransitionUpdateOrder(void);
 
         // oop.cpp
         uint8_t GetColorForTileMatch(const Tile &tile);
@@ -777,6 +892,7 @@ namespace ZZT {
 
         bool gameTitleExitRequested;
         bool gamePlayExitRequested;
+        bool gameStopRequested; // set by drivers; leaves both loops without prompting
         uint8_t gameStateElement;
         int16_t returnBoardId;
 
@@ -794,12 +910,26 @@ namespace ZZT {
         bool gamePaused;
         int16_t tickTimeCounter;
 
+        // Fast-forward: game ticks run back to back, and the viewport is only
+        // redrawn from board state once every fastForwardTicks ticks.
+        int16_t fastForwardTicks; // 0 = off
+        int16_t fastForwardCounter;
+        bool boardDrawSuppressed;
+
+        // Rewind: per-tick snapshots, captured while snapshots has a capacity.
+        SnapshotRing snapshots;
+        int16_t rewindPending; // ticks to rewind at the next tick boundary
+
         bool forceDarknessOff;
         uint8_t initialTextAttr;
+        uint8_t forestSoundTableIdx;
 
         char oopChar;
         sstring<20> oopWord;
         int16_t oopValue;
+        SoundPatternCache soundPatternCache; // #PLAY, keyed by stat data
+        StatScheduler statScheduler;
+        TickProfiler profiler;
 
         bool debugEnabled;
 
@@ -866,6 +996,10 @@ namespace ZZT {
         bool BoardPointCameraAt(int16_t sx, int16_t sy);
         void BoardDrawBorder(void);
         void TransitionDrawToBoard(void);
+        void BoardDrawViewport(void);
+        void FastForwardPresent(void);
+        void SetFastForward(int16_t ticks_per_frame);
+        bool RewindSnapshots(int16_t ticks);
         void SidebarPromptCharacter(bool editable, int16_t x, int16_t y, const char *prompt, uint8_t &value);
         void SidebarPromptSlider(bool editable, int16_t x, int16_t y,  const char *prompt, uint8_t &value);
         void SidebarPromptChoice(bool editable, int16_t y, const char *prompt, const char *choiceStr, uint8_t &result);
@@ -879,6 +1013,7 @@ namespace ZZT {
         bool GameWorldLoad(const char *extension);
         void AddStat(int16_t x, int16_t y, uint8_t element, uint8_t color, int16_t cycle, Stat tpl);
         void RemoveStat(int16_t stat_id);
+        void SetStatCycle(int16_t stat_id, int16_t cycle);
         bool BoardPrepareTileForPlacement(int16_t x, int16_t y);
         void MoveStat(int16_t stat_id, int16_t newX, int16_t newY, bool scrollOffset = true);
         void GameDrawSidebar(void);
@@ -387,15 +387,13 @@ void ZZT::irq_timer_pit(void) {
 	hsecs += 11;
 
 	if (!driver._queue.enabled) {
-		driver._queue.is_playing = false;
+		driver._queue.discard();
 		gba_play_sound(0);
 	} else {
 		if ((--duration_counter) <= 0) {
 			gba_play_sound(0);
 			uint16_t note, duration;
-			if (!driver._queue.pop(note, duration)) {
-				driver._queue.is_playing = false;
-			} else {
+			if (driver._queue.pop(note, duration)) {
 				if (note >= NOTE_MIN && note < NOTE_MAX) {
 					gba_play_sound(sound_notes[note - NOTE_MIN]);
 				} else if (note >= DRUM_MIN && note < DRUM_MAX) {
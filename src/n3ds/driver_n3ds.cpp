@@ -247,7 +247,7 @@ UserInterface *N3DSDriver::create_user_interface(Game &game, bool is_editor) {
 
 void N3DSDriver::on_pit_tick() {
 	hsecs += 11;
-	soundSimulator->allowed = _queue.is_playing;
+	soundSimulator->allowed = _queue.is_playing();
 
 	// TODO: wake PIT listeners
 }
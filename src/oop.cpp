@@ -2,6 +2,7 @@
 #include <cstdlib>
 #include <cstring>
 #include "gamevars.h"
+#include "trace.h"
 #include "txtwind.h"
 #include "platform_hacks.h"
 
@@ -169,9 +170,9 @@ int16_t Game::OopFindString(Stat& stat, int16_t start_pos, char *str) {
 		
 		int16_t pos = 0;
 
-		while (pos < stat.data.label_cache_len) {
+		while (pos < stat.data.label_cache_len()) {
 			size_t word_pos = 0;
-			int16_t cmp_pos = stat.data.label_cache[pos];
+			int16_t cmp_pos = stat.data.label_cache()[pos];
 			if (cmp_pos < start_pos) { pos++; continue; }
 			
 			do {
@@ -190,7 +191,7 @@ int16_t Game::OopFindString(Stat& stat, int16_t start_pos, char *str) {
 				// word continues, match invalid
 			} else {
 				// word complete, match valid
-				return stat.data.label_cache[pos];
+				return stat.data.label_cache()[pos];
 			}
 	NoMatchLbl:
 			pos++;
@@ -507,6 +508,8 @@ void Game::OopReadLineToEnd(Stat &stat, int16_t &position, char *buf, size_t len
 }
 
 bool Game::OopSend(int16_t stat_id, const char *sendLabel, bool ignoreLock) {
+	TRACE_SCOPE_ID("OopSend", stat_id < 0 ? -stat_id : stat_id);
+
 	bool ignoreSelfLock = false;
 	if (stat_id < 0) {
 		stat_id = -stat_id;
@@ -700,6 +703,7 @@ OopCommandResult ZZT::OopCommandZap(OopState &state) {
 	int16_t labelStatId = 0;
 	int16_t labelDataPos;
 	while (state.game.OopFindLabel(state.stat_id, oopWordCopy, labelStatId, labelDataPos, "\r:")) {
+		state.game.board.stats.detach_data(labelStatId);
 		state.game.board.stats[labelStatId].data.data[labelDataPos + 1] = '\'';
 	}
 	return OOP_COMMAND_FINISHED;
@@ -717,6 +721,7 @@ OopCommandResult ZZT::OopCommandRestore(OopState &state) {
 	int16_t labelDataPos;
 	while (state.game.OopFindLabel(state.stat_id, oopWordCopy, labelStatId, labelDataPos, "\r'")) {
 		Stat &labelStat = state.game.board.stats[labelStatId];
+		state.game.board.stats.detach_data(labelStatId);
 
 		do {
 			labelStat.data.data[labelDataPos + 1] = ':';
@@ -810,14 +815,23 @@ OopCommandResult ZZT::OopCommandChange(OopState &state) {
 }
 
 OopCommandResult ZZT::OopCommandPlay(OopState &state) {
-	char textLine[256];
-	state.game.OopReadLineToEnd(state.stat, state.position, textLine, sizeof(textLine));
-	if (!StrEmpty(textLine)) {
+	const char *owner = state.stat.data.data;
+	const SoundPatternCacheEntry *entry = state.game.soundPatternCache.get(owner, state.position);
+	if (entry != nullptr) {
+		state.position = entry->end_position;
+	} else {
+		int16_t position = state.position;
+		char textLine[256];
 		uint8_t buf[255];
-		int buflen = SoundParse(textLine, buf, sizeof(buf));
-		if (buflen > 0) {
-			state.game.driver->sound_queue(-1, buf, buflen);
+		int buflen = 0;
+		state.game.OopReadLineToEnd(state.stat, state.position, textLine, sizeof(textLine));
+		if (!StrEmpty(textLine)) {
+			buflen = SoundParse(textLine, buf, sizeof(buf));
 		}
+		entry = state.game.soundPatternCache.put(owner, position, state.position, buf, buflen);
+	}
+	if (entry->len > 0) {
+		state.game.driver->sound_queue(-1, entry->pattern, entry->len);
 	}
 	state.lineFinished = false;
 	return OOP_COMMAND_FINISHED;
@@ -826,7 +840,7 @@ OopCommandResult ZZT::OopCommandPlay(OopState &state) {
 OopCommandResult ZZT::OopCommandCycle(OopState &state) {
 	state.game.OopReadValue(state.stat, state.position);
 	if (state.game.oopValue > 0) {
-		state.stat.cycle = state.game.oopValue;
+		state.game.SetStatCycle(state.stat_id, state.game.oopValue);
 	}
 	return OOP_COMMAND_FINISHED;
 }
@@ -856,15 +870,26 @@ OopCommandResult ZZT::OopCommandBind(OopState &state) {
 	StrCopy(oopWordCopy, state.game.oopWord);
 	int16_t bindStatId = 0;
 	if (state.game.OopIterateStat(state.stat_id, bindStatId, oopWordCopy)) {
+		if (!state.stat.data.is_shared()) {
+			state.game.soundPatternCache.invalidate(state.stat.data.data);
+		}
 		state.game.board.stats.free_data_if_unused(state.stat_id);
-		state.stat.data = state.game.board.stats[bindStatId].data;
+		state.stat.data.bind(state.game.board.stats[bindStatId].data);
 		state.position = 0;
 	}
 	return OOP_COMMAND_FINISHED;
 }
 
 bool Game::OopExecute(int16_t stat_id, int16_t &position, const char *default_name) {
+	TRACE_SCOPE_ID("OopExecute", stat_id);
+	uint64_t profileStart;
+	uint16_t profileInstructions;
+
 StartParsing:
+	// The profiled run ends before the text window, and a hyperlink
+	// followed from it starts a new one.
+	profileStart = profiler.begin();
+	profileInstructions = 0;
 	Stat &stat = board.stats[stat_id];
 
 	OopState state = {
@@ -888,6 +913,7 @@ StartParsing:
 ReadInstruction:
 		state.lineFinished = true;
 		lastPosition = position;
+		profileInstructions++;
 		OopReadChar(stat, position);
 
 		// skip labels
@@ -995,14 +1021,27 @@ ReadCommand:
 				state.endOfProgram = true;
 			} break;
 			default: {
-				char textLine[66]; // should be enough?
-				textLine[0] = oopChar;
-				OopReadLineToEnd(stat, position, textLine + 1, sizeof(textLine) - 1);
+				// OpenZoo: append the line straight from the program, with
+				// the same limits and end position as OopReadLineToEnd.
+				const char *textLine = stat.data.data + position - 1;
+				int16_t textEnd = position;
+				while (textEnd < stat.data.len && stat.data.data[textEnd] != '\r' && stat.data.data[textEnd] != 0) {
+					textEnd++;
+				}
+				if (textEnd < stat.data.len) {
+					oopChar = stat.data.data[textEnd];
+					position = textEnd + 1;
+				} else {
+					oopChar = 0;
+					position = textEnd;
+				}
+				size_t textLen = stat.data.data + textEnd - textLine;
+				if (textLen > 65) textLen = 65;
 				if (state.textWindow == nullptr) {
 					state.textWindow = interface->CreateTextWindow(filesystem);
 					state.textWindow->selectable = false;
 				}
-				state.textWindow->Append(textLine);
+				state.textWindow->Append(textLine, textLen);
 			} break;
 		}
 	} while (!state.endOfProgram && !state.stopRunning && !state.repeatInsNextTick && !state.replaceStat && state.insCount <= 32);
@@ -1015,6 +1054,8 @@ ReadCommand:
 		position = -1;
 	}
 
+	profiler.end_object(*this, stat_id, profileInstructions, profileStart);
+
 	if (state.textWindow == nullptr) {
 		// implies 0 lines
 	} else if (state.textWindow->line_count > engineDefinition.messageLines) {
@@ -1032,9 +1073,11 @@ ReadCommand:
 		}
 
 		StrCopy(state.textWindow->title, name);
+		profiler.pause();
 		state.textWindow->DrawOpen();
 		state.textWindow->Select(true, false);
 		state.textWindow->DrawClose();
+		profiler.resume();
 		state.textWindow->Clear();
 
 		if (!StrEmpty(state.textWindow->hyperlink)) {
@@ -0,0 +1,200 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "gamevars.h"
+#include "profiler.h"
+
+using namespace ZZT;
+
+static const char *profile_kind_names[ProfileKindCount] = {
+    "tick", "touch", "draw"
+};
+
+TickProfiler::TickProfiler() {
+    active = false;
+    ticks = 0;
+    paused_ns = 0;
+    pause_start = 0;
+    pause_depth = 0;
+    elements = nullptr;
+    objects = nullptr;
+    object_count = 0;
+    object_size = 0;
+    object_slots = nullptr;
+    object_slots_size = 0;
+    slots_board = -1;
+}
+
+TickProfiler::~TickProfiler() {
+    clear();
+}
+
+void TickProfiler::start(void) {
+    if (elements == nullptr) {
+        elements = (ProfileCounter*) calloc(ProfileKindCount << 8, sizeof(ProfileCounter));
+    }
+    active = elements != nullptr;
+}
+
+void TickProfiler::stop(void) {
+    active = false;
+}
+
+void TickProfiler::clear(void) {
+    active = false;
+    ticks = 0;
+    free(elements);
+    elements = nullptr;
+    free(objects);
+    objects = nullptr;
+    object_count = 0;
+    object_size = 0;
+    free(object_slots);
+    object_slots = nullptr;
+    object_slots_size = 0;
+    slots_board = -1;
+}
+
+ProfileObject *TickProfiler::get_object(Game &game, int16_t stat_id) {
+    int16_t board_id = game.world.info.current_board;
+    if (board_id != slots_board || stat_id >= object_slots_size) {
+        int16_t size = game.board.stats.stat_size() + 1;
+        if (size <= stat_id) {
+            size = stat_id + 1;
+        }
+        if (size != object_slots_size) {
+            free(object_slots);
+            object_slots = (int16_t*) malloc(size * sizeof(int16_t));
+            object_slots_size = size;
+        }
+        for (int16_t i = 0; i < size; i++) {
+            object_slots[i] = -1;
+        }
+        slots_board = board_id;
+    }
+
+    int16_t idx = object_slots[stat_id];
+    if (idx < 0) {
+        // back on a board profiled before?
+        for (int16_t i = 0; i < object_count; i++) {
+            if (objects[i].board == board_id && objects[i].stat_id == stat_id) {
+                idx = i;
+                break;
+            }
+        }
+    }
+    if (idx < 0) {
+        if (object_count >= object_size) {
+            int16_t new_size = object_size > 0 ? object_size * 2 : 64;
+            ProfileObject *new_objects = (ProfileObject*) realloc(objects, new_size * sizeof(ProfileObject));
+            if (new_objects == nullptr) return nullptr;
+            objects = new_objects;
+            object_size = new_size;
+        }
+        idx = object_count++;
+
+        ProfileObject &object = objects[idx];
+        memset(&object, 0, sizeof(ProfileObject));
+        object.board = board_id;
+        object.stat_id = stat_id;
+
+        // name the object after its @name line, if it has one
+        Stat &stat = game.board.stats[stat_id];
+        if (stat.data.data != nullptr && stat.data.len > 1 && stat.data.data[0] == '@') {
+            size_t len = 0;
+            while (len < (size_t) (stat.data.len - 1) && len < (StrSize(object.name) - 1)
+                && stat.data.data[len + 1] != '\r') {
+                len++;
+            }
+            memcpy(object.name, stat.data.data + 1, len);
+            object.name[len] = 0;
+        }
+    }
+
+    object_slots[stat_id] = idx;
+    return &objects[idx];
+}
+
+void TickProfiler::end_object(Game &game, int16_t stat_id, uint16_t instructions, uint64_t start) {
+    if (!active || start == 0) return;
+
+    uint64_t ns = clock() - start;
+    ProfileObject *object = get_object(game, stat_id);
+    if (object != nullptr) {
+        object->runs++;
+        object->instructions += instructions;
+        object->ns += ns;
+    }
+}
+
+void TickProfiler::report(Game &game, std::function<void(const char*)> line) {
+    char text[64];
+
+    if (elements == nullptr) {
+        line("The profiler has not been started.");
+        return;
+    }
+
+    uint64_t tick_ns = 0;
+    for (int i = 0; i < 256; i++) {
+        tick_ns += elements[(ProfileTick << 8) | i].ns;
+    }
+    snprintf(text, sizeof(text), "%u ticks, %u us in element ticks",
+        ticks, (uint32_t) (tick_ns / 1000));
+    line(text);
+    line("");
+
+    // Both lists are shown slowest first; entries are picked by repeatedly
+    // taking the slowest one not yet shown.
+    line("Element       call     calls   time/us");
+    uint64_t shown_below = UINT64_MAX;
+    int shown_idx = -1;
+    for (int row = 0; row < PROFILER_REPORT_ROWS; row++) {
+        int best = -1;
+        for (int i = 0; i < (ProfileKindCount << 8); i++) {
+            const ProfileCounter &counter = elements[i];
+            if (counter.calls == 0) continue;
+            if (counter.ns > shown_below || (counter.ns == shown_below && i <= shown_idx)) continue;
+            if (best < 0 || counter.ns > elements[best].ns) best = i;
+        }
+        if (best < 0) break;
+
+        const ProfileCounter &counter = elements[best];
+        char name[14];
+        const char *def_name = game.elementDef(best & 0xFF).name;
+        if (def_name != nullptr && def_name[0] != 0) {
+            snprintf(name, sizeof(name), "%s", def_name);
+        } else {
+            snprintf(name, sizeof(name), "(%d)", best & 0xFF);
+        }
+        snprintf(text, sizeof(text), "%-13.13s %-5s %8u %9u",
+            name, profile_kind_names[best >> 8], counter.calls, (uint32_t) (counter.ns / 1000));
+        line(text);
+        shown_below = counter.ns;
+        shown_idx = best;
+    }
+
+    if (object_count > 0) {
+        line("");
+        line("Brd:Id  @name       runs  instr  time/us");
+        shown_below = UINT64_MAX;
+        shown_idx = -1;
+        for (int row = 0; row < PROFILER_REPORT_ROWS; row++) {
+            int best = -1;
+            for (int i = 0; i < object_count; i++) {
+                const ProfileObject &object = objects[i];
+                if (object.ns > shown_below || (object.ns == shown_below && i <= shown_idx)) continue;
+                if (best < 0 || object.ns > objects[best].ns) best = i;
+            }
+            if (best < 0) break;
+
+            const ProfileObject &object = objects[best];
+            snprintf(text, sizeof(text), "%3d:%-3d %-9.9s %6u %6u %8u",
+                object.board, object.stat_id, object.name, object.runs, object.instructions,
+                (uint32_t) (object.ns / 1000));
+            line(text);
+            shown_below = object.ns;
+            shown_idx = best;
+        }
+    }
+}
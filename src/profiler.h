@@ -0,0 +1,112 @@
+#ifndef __PROFILER_H__
+#define __PROFILER_H__
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include "utils/stringutils.h"
+
+// rows per section in a report
+#define PROFILER_REPORT_ROWS 20
+
+namespace ZZT {
+    class Game;
+
+    typedef enum {
+        ProfileTick,
+        ProfileTouch,
+        ProfileDraw,
+        ProfileKindCount
+    } ProfileKind;
+
+    struct ProfileCounter {
+        uint32_t calls;
+        uint64_t ns;
+    };
+
+    struct ProfileObject {
+        int16_t board;
+        int16_t stat_id;
+        sstring<20> name;
+        uint32_t runs;
+        uint32_t instructions;
+        uint64_t ns;
+    };
+
+    // Opt-in profiler for game ticks: call counts and cumulative time of the
+    // element tick, touch and draw procedures per element, and of OopExecute
+    // per object (keyed by board and stat ID), with OOP instruction counts.
+    // Times are inclusive - an object's tick includes its program run.
+    // Time spent in modal UI (text windows, prompts) between pause() and
+    // resume() is left out of every call which was running across it.
+    //
+    // Nothing is allocated, and begin() returns immediately, while stopped.
+    class TickProfiler {
+        bool active;
+        uint32_t ticks;
+        uint64_t paused_ns; // total time paused, taken out of the clock
+        uint64_t pause_start; // 0 if the profiler was stopped at pause()
+        int16_t pause_depth;
+        ProfileCounter *elements; // [ProfileKindCount][256]
+        ProfileObject *objects;
+        int16_t object_count, object_size;
+        int16_t *object_slots; // stat ID -> objects index, for slots_board
+        int16_t object_slots_size;
+        int16_t slots_board;
+
+        static inline uint64_t now(void) {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        // Calls are timed on this clock, which stands still between pause()
+        // and resume() from the point of view of calls open across them.
+        inline uint64_t clock(void) const { return now() - paused_ns; }
+
+        ProfileObject *get_object(Game &game, int16_t stat_id);
+
+    public:
+        TickProfiler();
+        ~TickProfiler();
+
+        void start(void);
+        void stop(void);
+        void clear(void);
+        inline bool is_active(void) const { return active; }
+        inline bool has_data(void) const { return elements != nullptr; }
+
+        // start of a timed call; pass the result on to the matching end call.
+        // Calls begun while stopped (start == 0) are not counted, even if
+        // they start the profiler themselves.
+        inline uint64_t begin(void) const { return active ? clock() : 0; }
+        inline void end(ProfileKind kind, uint8_t element, uint64_t start) {
+            if (active && start != 0) {
+                ProfileCounter &counter = elements[(kind << 8) | element];
+                counter.calls++;
+                counter.ns += clock() - start;
+            }
+        }
+        void end_object(Game &game, int16_t stat_id, uint16_t instructions, uint64_t start);
+        inline void tick_done(void) {
+            if (active) ticks++;
+        }
+
+        // around anything waiting on the player within a game tick; nests
+        inline void pause(void) {
+            if (pause_depth++ == 0) {
+                pause_start = active ? now() : 0;
+            }
+        }
+        inline void resume(void) {
+            if (pause_depth > 0 && --pause_depth == 0 && pause_start != 0) {
+                paused_ns += now() - pause_start;
+            }
+        }
+
+        // writes a report, one line (of at most 40 characters) at a time
+        void report(Game &game, std::function<void(const char*)> line);
+    };
+}
+
+#endif
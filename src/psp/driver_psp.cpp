@@ -152,7 +152,7 @@ void PSPDriver::update_input(void) {
 
 SceUInt ZZT::psp_timer_callback(SceUID uid, SceInt64 requested, SceInt64 actual, void *args) {
 	driver.hsecs += 11;
-    driver.soundSimulator->allowed = driver._queue.is_playing;
+    driver.soundSimulator->allowed = driver._queue.is_playing();
 
 	return !driver.running ? 0 : sceKernelUSec2SysClockWide(driver.pit_clock);
 }
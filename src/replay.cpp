@@ -0,0 +1,251 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "gamevars.h"
+#include "replay.h"
+
+using namespace ZZT;
+
+#define SESSION_MAGIC "OPENZOO-SESSION 1"
+
+static inline void hash_bytes(uint32_t &hash, const void *data, size_t len) {
+    const uint8_t *bytes = (const uint8_t*) data;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ bytes[i]) * 16777619;
+    }
+}
+
+template<typename T> static inline void hash_value(uint32_t &hash, T value) {
+    hash_bytes(hash, &value, sizeof(T));
+}
+
+static inline void hash_string(uint32_t &hash, const char *str) {
+    hash_bytes(hash, str, strlen(str) + 1);
+}
+
+uint32_t ZZT::SessionStateHash(Game &game) {
+    uint32_t hash = 2166136261;
+
+    // Hashed field by field, as structure padding is not guaranteed to be
+    // zeroed.
+    const WorldInfo &info = game.world.info;
+    hash_value(hash, info.ammo);
+    hash_value(hash, info.gems);
+    hash_bytes(hash, info.keys, sizeof(info.keys));
+    hash_value(hash, info.health);
+    hash_value(hash, info.current_board);
+    hash_value(hash, info.torches);
+    hash_value(hash, info.torch_ticks);
+    hash_value(hash, info.energizer_ticks);
+    hash_value(hash, info.score);
+    for (int i = 0; i < MAX_FLAG; i++) {
+        hash_string(hash, info.flags[i]);
+    }
+    hash_value(hash, info.board_time_sec);
+    hash_value(hash, info.board_time_hsec);
+    hash_value(hash, info.stones_of_power);
+
+    Board &board = game.board;
+    for (int ix = 0; ix <= board.width() + 1; ix++) {
+        for (int iy = 0; iy <= board.height() + 1; iy++) {
+            const Tile &tile = board.tiles.get(ix, iy);
+            hash_value(hash, tile.element);
+            hash_value(hash, tile.color);
+        }
+    }
+
+    hash_value(hash, board.stats.count);
+    for (int i = 0; i <= board.stats.count; i++) {
+        const Stat &stat = board.stats[i];
+        hash_value(hash, stat.x);
+        hash_value(hash, stat.y);
+        hash_value(hash, stat.step_x);
+        hash_value(hash, stat.step_y);
+        hash_value(hash, stat.cycle);
+        hash_value(hash, stat.p1);
+        hash_value(hash, stat.p2);
+        hash_value(hash, stat.p3);
+        hash_value(hash, stat.follower);
+        hash_value(hash, stat.leader);
+        hash_value(hash, stat.under.element);
+        hash_value(hash, stat.under.color);
+        hash_value(hash, stat.data_pos);
+        hash_value(hash, stat.data.len);
+        if (stat.data.data != nullptr && stat.data.len > 0) {
+            hash_bytes(hash, stat.data.data, stat.data.len);
+        }
+    }
+
+    for (int i = 0; i < game.engineDefinition.messageLines; i++) {
+        hash_string(hash, board.info.message[i]);
+    }
+    hash_value(hash, board.info.is_dark);
+
+    hash_value(hash, game.currentTick);
+    hash_value(hash, game.currentStatTicked);
+    hash_value(hash, game.random.GetSeed());
+    return hash;
+}
+
+// SessionRecorder
+
+SessionRecorder::SessionRecorder() {
+    file = nullptr;
+    tick_count = 0;
+}
+
+SessionRecorder::~SessionRecorder() {
+    close();
+}
+
+bool SessionRecorder::open(const char *filename, Game &game) {
+    close();
+    file = fopen(filename, "w");
+    if (file == nullptr) {
+        return false;
+    }
+    tick_count = 0;
+    fprintf(file, SESSION_MAGIC "\n");
+    fprintf(file, "S %08X %d %d %s\n", game.random.GetSeed(), game.tickSpeed, game.fastForwardTicks,
+        (const char*) game.startupWorldFileName);
+    return true;
+}
+
+void SessionRecorder::close(void) {
+    if (file != nullptr) {
+        fclose(file);
+        file = nullptr;
+    }
+}
+
+void SessionRecorder::record_input(const InputState &state) {
+    if (file == nullptr) return;
+    fprintf(file, "I %d %d %d %d %d %X %X\n", state.deltaX, state.deltaY, state.keyPressed,
+        (state.shiftPressed ? 1 : 0) | (state.shiftAccepted ? 2 : 0) | (state.joystickEnabled ? 4 : 0),
+        state.key_modifiers, state.joy_buttons_pressed, state.joy_buttons_held);
+}
+
+void SessionRecorder::record_hsecs(uint16_t hsecs) {
+    if (file == nullptr) return;
+    fprintf(file, "T %d\n", hsecs);
+}
+
+void SessionRecorder::record_world(Game &game, const char *name) {
+    if (file == nullptr) return;
+    fprintf(file, "W %08X %s\n", SessionStateHash(game), name);
+    fflush(file);
+}
+
+void SessionRecorder::record_tick(Game &game) {
+    tick_count++;
+    if (file == nullptr) return;
+    fprintf(file, "H %u %08X\n", tick_count, SessionStateHash(game));
+    // keep the recording usable if the game crashes
+    fflush(file);
+}
+
+// SessionReader
+
+SessionReader::SessionReader() {
+    file = nullptr;
+    line_number = 0;
+    type = SessionRecordNone;
+}
+
+SessionReader::~SessionReader() {
+    close();
+}
+
+bool SessionReader::open(const char *filename, Game &game) {
+    char line[256];
+
+    close();
+    file = fopen(filename, "r");
+    if (file == nullptr) {
+        return false;
+    }
+
+    line_number = 2;
+    if (fgets(line, sizeof(line), file) == nullptr || strncmp(line, SESSION_MAGIC, strlen(SESSION_MAGIC))) {
+        close();
+        return false;
+    }
+
+    unsigned int seed;
+    int speed, fast_forward, name_pos = 0;
+    if (fgets(line, sizeof(line), file) == nullptr
+        || sscanf(line, "S %X %d %d %n", &seed, &speed, &fast_forward, &name_pos) < 3
+        || name_pos == 0) {
+        close();
+        return false;
+    }
+    line[strcspn(line, "\r\n")] = 0;
+
+    game.random.SetSeed(seed);
+    game.tickSpeed = speed;
+    game.SetFastForward(fast_forward);
+    StrCopy(game.startupWorldFileName, line + name_pos);
+    return next();
+}
+
+void SessionReader::close(void) {
+    if (file != nullptr) {
+        fclose(file);
+        file = nullptr;
+    }
+    type = SessionRecordNone;
+}
+
+bool SessionReader::next(void) {
+    char line[256];
+
+    type = SessionRecordNone;
+    if (file == nullptr || fgets(line, sizeof(line), file) == nullptr) {
+        return false;
+    }
+    line_number++;
+
+    switch (line[0]) {
+    case 'I': {
+        int dx, dy, key, flags, mods;
+        unsigned int pressed, held;
+        if (sscanf(line + 1, "%d %d %d %d %d %X %X", &dx, &dy, &key, &flags, &mods, &pressed, &held) == 7) {
+            input.deltaX = dx;
+            input.deltaY = dy;
+            input.keyPressed = key;
+            input.shiftPressed = (flags & 1) != 0;
+            input.shiftAccepted = (flags & 2) != 0;
+            input.joystickEnabled = (flags & 4) != 0;
+            input.key_modifiers = mods;
+            input.joy_buttons_pressed = pressed;
+            input.joy_buttons_held = held;
+            type = SessionRecordInput;
+        }
+    } break;
+    case 'T': {
+        int value;
+        if (sscanf(line + 1, "%d", &value) == 1) {
+            hsecs = value;
+            type = SessionRecordHsecs;
+        }
+    } break;
+    case 'W': {
+        unsigned int value;
+        if (sscanf(line + 1, "%X", &value) == 1) {
+            hash = value;
+            type = SessionRecordWorld;
+        }
+    } break;
+    case 'H': {
+        unsigned int value_tick, value;
+        if (sscanf(line + 1, "%u %X", &value_tick, &value) == 2) {
+            tick = value_tick;
+            hash = value;
+            type = SessionRecordTick;
+        }
+    } break;
+    }
+
+    return type != SessionRecordNone;
+}
@@ -0,0 +1,92 @@
+#ifndef __REPLAY_H__
+#define __REPLAY_H__
+
+#include <cstdint>
+#include <cstdio>
+#include "driver.h"
+
+/*
+  Session recordings, for deterministic replays.
+
+  Besides its own state, the game only depends on the input it sees after
+  each update_input() and on the timer values read by HasTimeElapsed(). Given
+  the same world, Random seed and settings, replaying those reproduces a
+  session exactly. A state hash is logged after every game tick, so that a
+  replay can check itself against the original run.
+
+  Text format, one record per line:
+
+    OPENZOO-SESSION 1
+    S <seed> <tick speed> <fast-forward ticks> <startup world>
+    I <deltaX> <deltaY> <keyPressed> <flags> <key modifiers> <joy pressed> <joy held>
+    T <hsecs>                       (timer read)
+    W <hash> <name>                 (world loaded)
+    H <tick> <hash>                 (game tick completed)
+
+  Flags are 1 = shiftPressed, 2 = shiftAccepted, 4 = joystickEnabled; the
+  joystick button masks and hashes are hexadecimal.
+*/
+
+namespace ZZT {
+    class Game;
+
+    // FNV-1a hash of the simulation state: world info, the current board, the
+    // tick counters and the random seed.
+    uint32_t SessionStateHash(Game &game);
+
+    class SessionRecorder {
+    protected:
+        FILE *file;
+        uint32_t tick_count;
+
+    public:
+        SessionRecorder();
+        virtual ~SessionRecorder();
+
+        // writes the header from the game's seed and settings; call before
+        // GameTitleLoop()
+        bool open(const char *filename, Game &game);
+        void close(void);
+
+        inline uint32_t ticks(void) const { return tick_count; }
+
+        virtual void record_input(const InputState &state);
+        virtual void record_hsecs(uint16_t hsecs);
+        virtual void record_world(Game &game, const char *name);
+        virtual void record_tick(Game &game);
+    };
+
+    typedef enum {
+        SessionRecordNone, // end of file or unparseable line
+        SessionRecordInput,
+        SessionRecordHsecs,
+        SessionRecordWorld,
+        SessionRecordTick
+    } SessionRecordType;
+
+    class SessionReader {
+        FILE *file;
+        uint32_t line_number;
+
+    public:
+        // current record, valid until next()
+        SessionRecordType type;
+        InputState input;
+        uint16_t hsecs;
+        uint32_t tick;
+        uint32_t hash;
+
+        SessionReader();
+        ~SessionReader();
+
+        // reads the header and applies it to the game
+        bool open(const char *filename, Game &game);
+        void close(void);
+        bool next(void);
+
+        inline uint32_t line(void) const { return line_number; }
+        inline bool at_end(void) const { return file == nullptr || feof(file); }
+    };
+}
+
+#endif
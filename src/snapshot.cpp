@@ -0,0 +1,305 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include "gamevars.h"
+#include "snapshot.h"
+
+using namespace ZZT;
+
+// Unchanged tiles between two changed ones are cheaper to copy than to
+// start a new run for.
+#define SNAPSHOT_RUN_GAP 2
+
+struct SnapshotCode {
+    int32_t refs;
+    int16_t len;
+    char data[1];
+};
+
+struct SnapshotStat {
+    Stat stat; // without code
+    int16_t code; // index into GameSnapshot::codes, or -1
+};
+
+struct ZZT::GameSnapshot {
+    WorldInfo world_info;
+    BoardInfo board_info;
+    sstring<60> board_name;
+    int16_t current_tick;
+    uint32_t random_seed;
+
+    int16_t stat_count;
+    SnapshotStat *stats;
+    int16_t code_count;
+    SnapshotCode **codes;
+    StatData *code_sources; // stat data the codes were copied from
+
+    // runs of <start, length, tiles>, restoring this snapshot's tile plane
+    // from the next one's
+    uint8_t *tile_delta;
+    size_t tile_delta_len;
+};
+
+static inline bool tile_equals(const Tile &a, const Tile &b) {
+    return a.element == b.element && a.color == b.color;
+}
+
+static void snapshot_free(GameSnapshot &snap) {
+    for (int i = 0; i < snap.code_count; i++) {
+        if (--snap.codes[i]->refs <= 0) {
+            free(snap.codes[i]);
+        }
+    }
+    free(snap.codes);
+    free(snap.code_sources);
+    free(snap.stats);
+    free(snap.tile_delta);
+    memset(&snap, 0, sizeof(GameSnapshot));
+}
+
+static void snapshot_apply_delta(const GameSnapshot &snap, Tile *tiles) {
+    const uint8_t *delta = snap.tile_delta;
+    const uint8_t *delta_end = delta + snap.tile_delta_len;
+    while (delta < delta_end) {
+        uint16_t start, length;
+        memcpy(&start, delta, sizeof(uint16_t));
+        memcpy(&length, delta + 2, sizeof(uint16_t));
+        delta += 4;
+        memcpy(tiles + start, delta, length * sizeof(Tile));
+        delta += length * sizeof(Tile);
+    }
+}
+
+SnapshotRing::SnapshotRing() {
+    slots = nullptr;
+    capacity = 0;
+    first = 0;
+    count = 0;
+    latest_tiles = nullptr;
+    latest_cells = 0;
+    scratch = nullptr;
+    scratch_size = 0;
+}
+
+SnapshotRing::~SnapshotRing() {
+    set_capacity(0);
+}
+
+GameSnapshot &SnapshotRing::slot(int16_t idx) const {
+    return slots[(first + idx) % capacity];
+}
+
+void SnapshotRing::set_capacity(int16_t new_capacity) {
+    clear();
+    free(slots);
+    slots = nullptr;
+    capacity = new_capacity > 0 ? new_capacity : 0;
+    if (capacity > 0) {
+        slots = (GameSnapshot*) calloc(capacity, sizeof(GameSnapshot));
+        if (slots == nullptr) {
+            capacity = 0;
+        }
+    }
+    if (capacity == 0) {
+        free(latest_tiles);
+        latest_tiles = nullptr;
+        latest_cells = 0;
+        free(scratch);
+        scratch = nullptr;
+        scratch_size = 0;
+    }
+}
+
+void SnapshotRing::clear(void) {
+    while (count > 0) {
+        drop_oldest();
+    }
+    first = 0;
+}
+
+void SnapshotRing::drop_oldest(void) {
+    snapshot_free(slot(0));
+    first = (first + 1) % capacity;
+    count--;
+}
+
+void SnapshotRing::drop_newest(void) {
+    snapshot_free(slot(count - 1));
+    count--;
+    if (count > 0) {
+        // The new newest snapshot's tiles become the full plane.
+        GameSnapshot &snap = slot(count - 1);
+        snapshot_apply_delta(snap, latest_tiles);
+        free(snap.tile_delta);
+        snap.tile_delta = nullptr;
+        snap.tile_delta_len = 0;
+    }
+}
+
+void SnapshotRing::capture(Game &game) {
+    if (capacity <= 0) return;
+
+    Board &board = game.board;
+    const Tile *tiles = board.tiles.data();
+    int32_t cells = board.tiles.data_size();
+
+    if (cells != latest_cells) {
+        // new engine; the tile planes are not comparable
+        clear();
+        free(latest_tiles);
+        free(scratch);
+        latest_cells = cells;
+        latest_tiles = (Tile*) malloc(cells * sizeof(Tile));
+        // worst case: one changed tile in every run
+        scratch_size = cells * (4 + sizeof(Tile)) / (SNAPSHOT_RUN_GAP / 2 + 1) + 4 + sizeof(Tile);
+        scratch = (uint8_t*) malloc(scratch_size);
+    }
+
+    if (count >= capacity) {
+        drop_oldest();
+    }
+
+    if (count > 0) {
+        // Turn the previous newest snapshot's tile plane into a delta.
+        GameSnapshot &prev = slot(count - 1);
+        size_t len = 0;
+        int32_t i = 0;
+        while (i < cells) {
+            if (tile_equals(tiles[i], latest_tiles[i])) {
+                i++;
+                continue;
+            }
+            int32_t end = i + 1;
+            for (int32_t j = end; j < cells && (j - end) < SNAPSHOT_RUN_GAP; j++) {
+                if (!tile_equals(tiles[j], latest_tiles[j])) {
+                    end = j + 1;
+                }
+            }
+            uint16_t start = i, length = end - i;
+            memcpy(scratch + len, &start, sizeof(uint16_t));
+            memcpy(scratch + len + 2, &length, sizeof(uint16_t));
+            memcpy(scratch + len + 4, latest_tiles + i, length * sizeof(Tile));
+            len += 4 + length * sizeof(Tile);
+            i = end;
+        }
+        if (len > 0) {
+            prev.tile_delta = (uint8_t*) malloc(len);
+            memcpy(prev.tile_delta, scratch, len);
+        }
+        prev.tile_delta_len = len;
+    }
+    memcpy(latest_tiles, tiles, cells * sizeof(Tile));
+
+    GameSnapshot *prev = count > 0 ? &slot(count - 1) : nullptr;
+    GameSnapshot &snap = slot(count++);
+    snap.world_info = game.world.info;
+    snap.board_info = board.info;
+    StrCopy(snap.board_name, board.name);
+    snap.current_tick = game.currentTick;
+    snap.random_seed = game.random.GetSeed();
+
+    int16_t stat_count = board.stats.count;
+    snap.stat_count = stat_count;
+    snap.stats = (SnapshotStat*) malloc((stat_count + 1) * sizeof(SnapshotStat));
+    snap.codes = (SnapshotCode**) malloc((stat_count + 1) * sizeof(SnapshotCode*));
+    snap.code_sources = (StatData*) malloc((stat_count + 1) * sizeof(StatData));
+    snap.code_count = 0;
+
+    for (int16_t i = 0; i <= stat_count; i++) {
+        Stat &stat = board.stats[i];
+        SnapshotStat &dst = snap.stats[i];
+        dst.stat = stat;
+        dst.stat.data.clear_data();
+        dst.stat.data.len = stat.data.len;
+        dst.code = -1;
+        if (stat.data.data == nullptr || stat.data.len <= 0) {
+            continue;
+        }
+
+        // bound to an earlier stat's code?
+        for (int16_t c = 0; c < snap.code_count; c++) {
+            if (snap.code_sources[c] == stat.data) {
+                dst.code = c;
+                break;
+            }
+        }
+        if (dst.code >= 0) {
+            continue;
+        }
+
+        // unchanged since the previous snapshot?
+        SnapshotCode *code = nullptr;
+        if (prev != nullptr) {
+            for (int16_t c = 0; c < prev->code_count; c++) {
+                SnapshotCode *prev_code = prev->codes[c];
+                if (prev->code_sources[c].data == stat.data.data && prev_code->len == stat.data.len
+                    && !memcmp(prev_code->data, stat.data.data, stat.data.len)) {
+                    code = prev_code;
+                    code->refs++;
+                    break;
+                }
+            }
+        }
+        if (code == nullptr) {
+            code = (SnapshotCode*) malloc(offsetof(SnapshotCode, data) + stat.data.len);
+            code->refs = 1;
+            code->len = stat.data.len;
+            memcpy(code->data, stat.data.data, stat.data.len);
+        }
+
+        snap.codes[snap.code_count] = code;
+        snap.code_sources[snap.code_count] = stat.data;
+        dst.code = snap.code_count++;
+    }
+}
+
+bool SnapshotRing::restore(Game &game, int16_t ticks_back) {
+    if (ticks_back < 0 || ticks_back >= count || game.board.tiles.data_size() != latest_cells) {
+        return false;
+    }
+
+    for (int16_t i = 0; i < ticks_back; i++) {
+        drop_newest();
+    }
+    GameSnapshot &snap = slot(count - 1);
+
+    Board &board = game.board;
+    if (snap.world_info.current_board != game.world.info.current_board) {
+        // keep the board being left
+        game.BoardClose();
+    } else {
+        board.stats.free_all_data();
+    }
+
+    game.world.info = snap.world_info;
+    board.info = snap.board_info;
+    StrCopy(board.name, snap.board_name);
+    memcpy(board.tiles.data(), latest_tiles, latest_cells * sizeof(Tile));
+
+    board.stats.count = snap.stat_count;
+    for (int16_t i = 0; i <= snap.stat_count; i++) {
+        board.stats[i] = snap.stats[i].stat;
+    }
+    for (int16_t c = 0; c < snap.code_count; c++) {
+        SnapshotCode *code = snap.codes[c];
+        int16_t first = -1;
+        for (int16_t i = 0; i <= snap.stat_count; i++) {
+            if (snap.stats[i].code != c) {
+                continue;
+            } else if (first < 0) {
+                first = i;
+                board.stats[i].data.alloc_data(code->len);
+                memcpy(board.stats[i].data.data, code->data, code->len);
+            } else {
+                board.stats[i].data.bind(board.stats[first].data);
+            }
+        }
+        // let the next capture share this code again
+        snap.code_sources[c] = board.stats[first].data;
+    }
+
+    game.currentTick = snap.current_tick;
+    game.random.SetSeed(snap.random_seed);
+    return true;
+}
@@ -0,0 +1,54 @@
+#ifndef __SNAPSHOT_H__
+#define __SNAPSHOT_H__
+
+#include <cstddef>
+#include <cstdint>
+
+#define SNAPSHOT_DEBUG_CAPACITY 256
+#define SNAPSHOT_REWIND_TICKS 16
+
+namespace ZZT {
+    class Game;
+    struct GameSnapshot;
+    struct Tile;
+
+    // Ring of per-tick snapshots of the world info and the current board,
+    // for rewinding.
+    //
+    // Only the newest snapshot's tile plane is kept in full; every older
+    // snapshot stores the runs of tiles which differ from its successor.
+    // Stats are copied whole, but their code is kept in reference counted
+    // blobs, shared with the previous snapshot for as long as it is unchanged.
+    class SnapshotRing {
+        GameSnapshot *slots;
+        int16_t capacity;
+        int16_t first, count;
+
+        Tile *latest_tiles; // tile plane of the newest snapshot
+        int32_t latest_cells;
+        uint8_t *scratch; // delta encoding buffer
+        size_t scratch_size;
+
+        GameSnapshot &slot(int16_t idx) const;
+        void drop_oldest(void);
+        void drop_newest(void);
+
+    public:
+        SnapshotRing();
+        ~SnapshotRing();
+
+        // capacity in snapshots; 0 disables capturing and frees everything
+        void set_capacity(int16_t capacity);
+        inline int16_t get_capacity(void) const { return capacity; }
+        inline int16_t size(void) const { return count; }
+
+        void clear(void);
+        // call between game ticks
+        void capture(Game &game);
+        // restores the snapshot taken ticks_back captures before the newest
+        // one into the game, dropping all newer snapshots
+        bool restore(Game &game, int16_t ticks_back);
+    };
+}
+
+#endif
@@ -1,6 +1,7 @@
 #include <cstdint>
 #include <cstring>
 #include "gamevars.h"
+#include "replay.h"
 #include "sounds.h"
 
 using namespace ZZT;
@@ -29,52 +30,102 @@ const SoundDrum ZZT::sound_drums[DRUM_MAX - DRUM_MIN] = {
 	{14, {378,	331,	316,	230,	224,	384,	480,	320,	358,	412,	376,	621,	554,	426,	0}}
 };
 
+#define STATE_EPOCH(s) ((uint8_t) (s))
+#define STATE_START(s) ((uint8_t) ((s) >> 8))
+#define STATE_END(s) ((uint8_t) ((s) >> 16))
+#define STATE_MAKE(epoch, start, end) ((epoch) | ((start) << 8) | ((end) << 16))
+
 SoundQueue::SoundQueue() {
+    for (int i = 0; i < 256; i++) {
+        buffer[i].store(0, std::memory_order_relaxed);
+    }
+    state.store(STATE_IDLE, std::memory_order_relaxed);
+    drained_state.store(STATE_IDLE, std::memory_order_relaxed);
+    consumer_pos.store(0, std::memory_order_relaxed);
+    current_priority = 0;
+    read_epoch = 0;
+    read_pos = 0;
     enabled = true;
     block_queueing = false;
-    clear();
+}
+
+bool SoundQueue::is_playing(void) const {
+    uint32_t s = state.load(std::memory_order_acquire);
+    return !(s & STATE_IDLE) && s != drained_state.load(std::memory_order_acquire);
 }
 
 void SoundQueue::queue(int16_t priority, const uint8_t *pattern, int len) {
+    bool playing = is_playing();
     if (!block_queueing &&
-        (!is_playing || (
+        (!playing || (
                 ((priority >= current_priority) && (current_priority != -1))
                 || (priority == -1)
             )
         )
     ) {
-         if (priority >= 0 || !is_playing) {
+        uint32_t s = state.load(std::memory_order_relaxed);
+        uint8_t epoch = STATE_EPOCH(s);
+        uint8_t start = STATE_START(s);
+        uint8_t end = STATE_END(s);
+
+        if (priority >= 0 || !playing) {
             current_priority = priority;
-            memcpy(buffer, pattern, len);
-            bufpos = 0;
-            buflen = len;
+            if (len > 255) len = 255;
+            // Open the new epoch before overwriting anything, so that a
+            // consumer reading the old pattern notices and retries.
+            epoch++;
+            start = end;
+            state.store(STATE_MAKE(epoch, start, end), std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
         } else {
-            if (bufpos > 0) {
-                memmove(buffer, buffer + bufpos, buflen - bufpos);
-                buflen -= bufpos;
-                bufpos = 0;
-            }
-            if ((buflen + len) < 255) {
-                memcpy(buffer + buflen, pattern, len);
-                buflen += len;
+            // The consumer may still be reading anything from its position
+            // onwards; it starts at the beginning of an epoch it has not seen.
+            uint16_t c = consumer_pos.load(std::memory_order_acquire);
+            uint8_t head = ((uint8_t) c == epoch) ? (c >> 8) : start;
+            if (((uint8_t) (end - head) + len) >= 255) {
+                return;
             }
         }
-        is_playing = true;
+
+        for (int i = 0; i < len; i++) {
+            buffer[(uint8_t) (end + i)].store(pattern[i], std::memory_order_relaxed);
+        }
+        end += len;
+        state.store(STATE_MAKE(epoch, start, end), std::memory_order_release);
     }
 }
 
 void SoundQueue::clear(void) {
-    bufpos = 0;
-    buflen = 0;
-    is_playing = false;
+    uint32_t s = state.load(std::memory_order_relaxed);
+    uint8_t epoch = STATE_EPOCH(s) + 1;
+    state.store(STATE_MAKE(epoch, STATE_END(s), STATE_END(s)) | STATE_IDLE, std::memory_order_release);
 }
 
 bool SoundQueue::pop(uint16_t &note, uint16_t &duration) {
-    if (bufpos >= buflen) {
-        return false;
-    } else {
-        note = buffer[bufpos++];
-        duration = buffer[bufpos++];
+    while (true) {
+        uint32_t s = state.load(std::memory_order_acquire);
+        uint8_t epoch = STATE_EPOCH(s);
+        if (epoch != read_epoch) {
+            read_epoch = epoch;
+            read_pos = STATE_START(s);
+        }
+
+        if ((s & STATE_IDLE) || (uint8_t) (STATE_END(s) - read_pos) < 2) {
+            consumer_pos.store(read_epoch | (read_pos << 8), std::memory_order_release);
+            drained_state.store(s, std::memory_order_release);
+            return false;
+        }
+
+        note = buffer[read_pos].load(std::memory_order_relaxed);
+        duration = buffer[(uint8_t) (read_pos + 1)].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (STATE_EPOCH(state.load(std::memory_order_relaxed)) != epoch) {
+            // replaced while reading
+            continue;
+        }
+
+        read_pos += 2;
+        consumer_pos.store(read_epoch | (read_pos << 8), std::memory_order_release);
         if (duration == 0) {
             // emulate ZZT overflow
             duration = 256;
@@ -83,6 +134,56 @@ bool SoundQueue::pop(uint16_t &note, uint16_t &duration) {
     }
 }
 
+void SoundQueue::discard(void) {
+    uint32_t s = state.load(std::memory_order_acquire);
+    read_epoch = STATE_EPOCH(s);
+    read_pos = STATE_END(s);
+    consumer_pos.store(read_epoch | (read_pos << 8), std::memory_order_release);
+    drained_state.store(s, std::memory_order_release);
+}
+
+static inline uint32_t pattern_cache_slot(const void *owner, int16_t position) {
+    uint32_t hash = (uint32_t) ((uintptr_t) owner >> 4) * 31 + (uint16_t) position;
+    return (hash ^ (hash >> 8)) & (SOUND_PATTERN_CACHE_SIZE - 1);
+}
+
+SoundPatternCache::SoundPatternCache() {
+    clear();
+}
+
+const SoundPatternCacheEntry *SoundPatternCache::get(const void *owner, int16_t position) {
+    const SoundPatternCacheEntry &entry = entries[pattern_cache_slot(owner, position)];
+    if (owner != nullptr && entry.owner == owner && entry.position == position) {
+        return &entry;
+    } else {
+        return nullptr;
+    }
+}
+
+const SoundPatternCacheEntry *SoundPatternCache::put(const void *owner, int16_t position, int16_t end_position, const uint8_t *pattern, uint8_t len) {
+    SoundPatternCacheEntry &entry = entries[pattern_cache_slot(owner, position)];
+    entry.owner = owner;
+    entry.position = position;
+    entry.end_position = end_position;
+    entry.len = len;
+    memcpy(entry.pattern, pattern, len);
+    return &entry;
+}
+
+void SoundPatternCache::invalidate(const void *owner) {
+    for (int i = 0; i < SOUND_PATTERN_CACHE_SIZE; i++) {
+        if (entries[i].owner == owner) {
+            entries[i].owner = nullptr;
+        }
+    }
+}
+
+void SoundPatternCache::clear(void) {
+    for (int i = 0; i < SOUND_PATTERN_CACHE_SIZE; i++) {
+        entries[i].owner = nullptr;
+    }
+}
+
 size_t ZZT::SoundParse(const char *input, uint8_t *output, size_t outlen) {
     uint8_t note_octave = 3;
     uint8_t note_duration = 1;
@@ -150,6 +251,9 @@ size_t ZZT::SoundParse(const char *input, uint8_t *output, size_t outlen) {
 
 bool Game::HasTimeElapsed(int16_t &counter, int16_t duration) {
     int16_t hSecsTotal = driver->get_hsecs();
+    if (driver->recorder != nullptr) {
+        driver->recorder->record_hsecs(hSecsTotal);
+    }
     uint16_t hSecsDiff = ((hSecsTotal - counter) + 6000) % 6000;
 
     if (hSecsDiff >= duration) {
@@ -1,6 +1,7 @@
 #ifndef __SOUNDS_H__
 #define __SOUNDS_H__
 
+#include <atomic>
 #include <cstdint>
 
 #define NOTE_MIN 16
@@ -8,6 +9,10 @@
 #define DRUM_MIN 240
 #define DRUM_MAX 250
 
+#ifndef SOUND_PATTERN_CACHE_SIZE
+#define SOUND_PATTERN_CACHE_SIZE 32 /* power of two */
+#endif
+
 namespace ZZT {
     struct SoundDrum {
         uint8_t len;
@@ -16,21 +21,65 @@ namespace ZZT {
 
     size_t SoundParse(const char *input, uint8_t *output, size_t outlen);
 
+    // Wait-free single-producer (game thread), single-consumer (audio
+    // callback or timer IRQ) note queue. The producer publishes the bounds
+    // of the current pattern in one atomic word; replacing the pattern
+    // starts a new epoch, and the consumer retries any read which raced
+    // with one. Neither side ever waits for the other.
     class SoundQueue {
-        int16_t bufpos;
-        int16_t buflen;
+        // state word layout
+        static const uint32_t STATE_IDLE = 0x1000000;
+
+        std::atomic<uint8_t> buffer[256];
+        std::atomic<uint32_t> state; // epoch | (start << 8) | (end << 16) | STATE_IDLE
+        std::atomic<uint32_t> drained_state; // last state the consumer ran out of notes in
+        std::atomic<uint16_t> consumer_pos; // epoch | (read_pos << 8)
+
+        // producer-only
         int16_t current_priority;
-        uint8_t buffer[255];
+
+        // consumer-only
+        uint8_t read_epoch;
+        uint8_t read_pos;
 
     public:
-        bool enabled;
-        bool is_playing;
+        std::atomic<bool> enabled;
         bool block_queueing;
 
         SoundQueue();
 
+        // producer
         void queue(int16_t priority, const uint8_t *pattern, int len);
+        void clear(void);
+
+        // consumer
         bool pop(uint16_t &note, uint16_t &duration);
+        void discard(void);
+
+        // either side
+        bool is_playing(void) const;
+    };
+
+    struct SoundPatternCacheEntry {
+        const void *owner; // nullptr if unused
+        int16_t position;
+        int16_t end_position;
+        uint8_t len;
+        uint8_t pattern[255];
+    };
+
+    // Parsed #PLAY patterns, keyed by program text and offset. The owner
+    // must be invalidated when its text is freed or modified.
+    class SoundPatternCache {
+        SoundPatternCacheEntry entries[SOUND_PATTERN_CACHE_SIZE];
+
+    public:
+        SoundPatternCache();
+
+        // Returns the matching entry, or nullptr on a miss.
+        const SoundPatternCacheEntry *get(const void *owner, int16_t position);
+        const SoundPatternCacheEntry *put(const void *owner, int16_t position, int16_t end_position, const uint8_t *pattern, uint8_t len);
+        void invalidate(const void *owner);
         void clear(void);
     };
 
@@ -0,0 +1,209 @@
+#include "trace.h"
+
+#ifdef OPENZOO_TRACE
+
+#include <chrono>
+#include <cstdio>
+#include <new>
+
+// events per buffer chunk
+#define TRACE_CHUNK_EVENTS 4096
+
+using namespace ZZT;
+
+namespace {
+    struct TraceEvent {
+        const char *name;
+        uint64_t ts, dur;
+        int32_t arg;
+        char phase;
+    };
+
+    // Only the owning thread appends to a chunk; count is published after
+    // the event is written, so a reader sees complete events only.
+    struct TraceChunk {
+        std::atomic<TraceChunk*> next;
+        std::atomic<uint32_t> count;
+        TraceEvent events[TRACE_CHUNK_EVENTS];
+    };
+
+    struct TraceBuffer {
+        TraceBuffer *next;
+        uint32_t tid;
+        int32_t depth; // open TRACE_BEGIN spans
+        std::atomic<const char*> thread_name;
+        TraceChunk *first, *last;
+    };
+}
+
+std::atomic<bool> ZZT::trace_active(false);
+
+static std::atomic<TraceBuffer*> trace_buffers(nullptr);
+static std::atomic<uint32_t> trace_next_tid(1);
+static std::atomic<bool> trace_started(false);
+static FILE *trace_file = nullptr;
+static uint64_t trace_start_ns;
+static thread_local TraceBuffer *trace_buffer = nullptr;
+
+static TraceChunk *trace_chunk_alloc(void) {
+    TraceChunk *chunk = new (std::nothrow) TraceChunk;
+    if (chunk != nullptr) {
+        chunk->next.store(nullptr, std::memory_order_relaxed);
+        chunk->count.store(0, std::memory_order_relaxed);
+    }
+    return chunk;
+}
+
+static TraceBuffer *trace_get_buffer(void) {
+    if (trace_buffer == nullptr) {
+        TraceChunk *chunk = trace_chunk_alloc();
+        if (chunk == nullptr) return nullptr;
+
+        TraceBuffer *buffer = new (std::nothrow) TraceBuffer();
+        if (buffer == nullptr) {
+            delete chunk;
+            return nullptr;
+        }
+        buffer->tid = trace_next_tid.fetch_add(1, std::memory_order_relaxed);
+        buffer->depth = 0;
+        buffer->thread_name = nullptr;
+        buffer->first = buffer->last = chunk;
+
+        // Buffers are never unlinked, so a plain push is enough.
+        TraceBuffer *head = trace_buffers.load(std::memory_order_relaxed);
+        do {
+            buffer->next = head;
+        } while (!trace_buffers.compare_exchange_weak(head, buffer,
+            std::memory_order_release, std::memory_order_relaxed));
+        trace_buffer = buffer;
+    }
+    return trace_buffer;
+}
+
+uint64_t ZZT::TraceNow(void) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void ZZT::TraceRecord(char phase, const char *name, uint64_t ts, uint64_t dur, int32_t arg) {
+    TraceBuffer *buffer = trace_get_buffer();
+    if (buffer == nullptr) return;
+
+    TraceChunk *chunk = buffer->last;
+    uint32_t count = chunk->count.load(std::memory_order_relaxed);
+    if (count >= TRACE_CHUNK_EVENTS) {
+        TraceChunk *next = trace_chunk_alloc();
+        if (next == nullptr) return;
+        chunk->next.store(next, std::memory_order_release);
+        buffer->last = chunk = next;
+        count = 0;
+    }
+
+    TraceEvent &event = chunk->events[count];
+    event.name = name;
+    event.ts = ts;
+    event.dur = dur;
+    event.arg = arg;
+    event.phase = phase;
+    chunk->count.store(count + 1, std::memory_order_release);
+
+    if (phase == 'B') {
+        buffer->depth++;
+    }
+}
+
+void ZZT::TraceEnd(void) {
+    TraceBuffer *buffer = trace_buffer;
+    if (buffer == nullptr || buffer->depth <= 0) return;
+
+    buffer->depth--;
+    TraceRecord('E', nullptr, TraceNow(), 0, TRACE_NO_ARG);
+}
+
+void ZZT::TraceThreadName(const char *name) {
+    TraceBuffer *buffer = trace_get_buffer();
+    if (buffer != nullptr && buffer->thread_name.load(std::memory_order_relaxed) != name) {
+        buffer->thread_name.store(name, std::memory_order_release);
+    }
+}
+
+bool ZZT::TraceStart(const char *filename) {
+    if (trace_started.exchange(true)) {
+        return false;
+    }
+    trace_file = fopen(filename, "w");
+    if (trace_file == nullptr) {
+        return false;
+    }
+    trace_start_ns = TraceNow();
+    trace_active.store(true, std::memory_order_release);
+    return true;
+}
+
+static void trace_write_event(FILE *file, bool &first, uint32_t tid, const TraceEvent &event) {
+    fprintf(file, "%s\n{\"ph\":\"%c\",\"pid\":1,\"tid\":%u,\"ts\":%.3f",
+        first ? "" : ",", event.phase, tid,
+        (event.ts > trace_start_ns ? (event.ts - trace_start_ns) : 0) / 1000.0);
+    first = false;
+    if (event.name != nullptr) {
+        fprintf(file, ",\"name\":\"%s\"", event.name);
+    }
+    if (event.phase == 'X') {
+        fprintf(file, ",\"dur\":%.3f", event.dur / 1000.0);
+    } else if (event.phase == 'i') {
+        fprintf(file, ",\"s\":\"t\"");
+    }
+    if (event.arg != TRACE_NO_ARG) {
+        fprintf(file, ",\"args\":{\"id\":%d}", event.arg);
+    }
+    fputc('}', file);
+}
+
+void ZZT::TraceStop(void) {
+    if (trace_file == nullptr) {
+        return;
+    }
+    trace_active.store(false, std::memory_order_release);
+    uint64_t stop_ns = TraceNow();
+
+    FILE *file = trace_file;
+    bool first = true;
+    fprintf(file, "{\"traceEvents\":[");
+
+    for (TraceBuffer *buffer = trace_buffers.load(std::memory_order_acquire); buffer != nullptr; buffer = buffer->next) {
+        const char *thread_name = buffer->thread_name.load(std::memory_order_acquire);
+        if (thread_name != nullptr) {
+            fprintf(file, "%s\n{\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"name\":\"thread_name\",\"args\":{\"name\":\"%s\"}}",
+                first ? "" : ",", buffer->tid, thread_name);
+            first = false;
+        }
+
+        // Threads may still be recording; only the published events are
+        // written, and spans left open are closed at the stop time.
+        int32_t open_spans = 0;
+        for (TraceChunk *chunk = buffer->first; chunk != nullptr; chunk = chunk->next.load(std::memory_order_acquire)) {
+            uint32_t count = chunk->count.load(std::memory_order_acquire);
+            for (uint32_t i = 0; i < count; i++) {
+                const TraceEvent &event = chunk->events[i];
+                if (event.ts > stop_ns) continue;
+                if (event.phase == 'B') {
+                    open_spans++;
+                } else if (event.phase == 'E') {
+                    open_spans--;
+                }
+                trace_write_event(file, first, buffer->tid, event);
+            }
+        }
+
+        TraceEvent close_event = {nullptr, stop_ns, 0, TRACE_NO_ARG, 'E'};
+        for (; open_spans > 0; open_spans--) {
+            trace_write_event(file, first, buffer->tid, close_event);
+        }
+    }
+
+    fprintf(file, "\n]}\n");
+    fclose(file);
+    trace_file = nullptr;
+}
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include <cstdint>
+#include "config.h"
+
+#define TRACE_NO_ARG INT32_MIN
+
+// Hot-path tracing, written out in the Chrome trace event format (which
+// chrome://tracing and ui.perfetto.dev both open).
+//
+// The TRACE_* macros expand to nothing unless the build defines OPENZOO_TRACE
+// (meson -Dtrace=true). Event names must be string literals, or otherwise
+// outlive the trace.
+//
+// Each thread records into its own buffer, which only that thread writes to;
+// TraceStop() writes out whatever the threads have published so far.
+// Tracing is meant to be started once per run.
+
+#ifdef OPENZOO_TRACE
+
+#include <atomic>
+
+namespace ZZT {
+    extern std::atomic<bool> trace_active;
+
+    uint64_t TraceNow(void);
+    void TraceRecord(char phase, const char *name, uint64_t ts, uint64_t dur, int32_t arg);
+    void TraceEnd(void);
+    void TraceThreadName(const char *name);
+
+    inline bool TraceActive(void) {
+        return trace_active.load(std::memory_order_relaxed);
+    }
+
+    // Records a complete event covering its own lifetime.
+    class TraceScope {
+        const char *name;
+        int32_t arg;
+        uint64_t start;
+
+    public:
+        inline TraceScope(const char *name, int32_t arg = TRACE_NO_ARG)
+            : name(name), arg(arg), start(TraceActive() ? TraceNow() : 0) { }
+        inline ~TraceScope() {
+            if (start != 0) {
+                TraceRecord('X', name, start, TraceNow() - start, arg);
+            }
+        }
+    };
+
+    // Starts recording, to be written to the given file; false if the file
+    // cannot be created or a trace is already running.
+    bool TraceStart(const char *filename);
+    void TraceStop(void);
+}
+
+#define TRACE_CONCAT_(a, b) a ## b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+#define TRACE_SCOPE(name) ZZT::TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(name)
+#define TRACE_SCOPE_ID(name, id) ZZT::TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(name, id)
+#define TRACE_BEGIN(name) do { if (ZZT::TraceActive()) ZZT::TraceRecord('B', name, ZZT::TraceNow(), 0, TRACE_NO_ARG); } while (0)
+#define TRACE_BEGIN_ID(name, id) do { if (ZZT::TraceActive()) ZZT::TraceRecord('B', name, ZZT::TraceNow(), 0, id); } while (0)
+// Ends the innermost TRACE_BEGIN span of this thread; does nothing if none is open.
+#define TRACE_END() do { if (ZZT::TraceActive()) ZZT::TraceEnd(); } while (0)
+#define TRACE_INSTANT(name) do { if (ZZT::TraceActive()) ZZT::TraceRecord('i', name, ZZT::TraceNow(), 0, TRACE_NO_ARG); } while (0)
+#define TRACE_THREAD_NAME(name) ZZT::TraceThreadName(name)
+
+#else
+
+namespace ZZT {
+    inline bool TraceStart(const char *filename) { return false; }
+    inline void TraceStop(void) { }
+}
+
+#define TRACE_SCOPE(name)
+#define TRACE_SCOPE_ID(name, id)
+#define TRACE_BEGIN(name) do { } while (0)
+#define TRACE_BEGIN_ID(name, id) do { } while (0)
+#define TRACE_END() do { } while (0)
+#define TRACE_INSTANT(name) do { } while (0)
+#define TRACE_THREAD_NAME(name) do { } while (0)
+
+#endif
+
+#endif
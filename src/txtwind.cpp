@@ -1,6 +1,7 @@
 #include <cstddef>
 #include <cstdlib>
 #include <cstring>
+#include <utility>
 #include "txtwind.h"
 
 using namespace ZZT;
@@ -40,6 +41,11 @@ TextWindow::TextWindow(Driver *driver, FilesystemDriver *filesystem, int16_t w_x
     this->line_pos = 0;
     StrClear(this->loaded_filename);
     this->screenCopy = nullptr;
+    this->view_data = nullptr;
+    this->view_buffer = nullptr;
+    this->view_lines = nullptr;
+    this->view_labels = nullptr;
+    this->view_label_count = 0;
     lines = (DynString**) malloc(sizeof(DynString*) * MAX_TEXT_WINDOW_LINES);
     this->color = 0x10;
 }
@@ -57,8 +63,20 @@ int TextWindow::PageMoveHeightLines(void) {
 }
 
 void TextWindow::Clear(void) {
-    for (int i = 0; i < this->line_count; i++)
-        delete this->lines[i];
+    if (this->view_data != nullptr) {
+        free(this->view_buffer);
+        free(this->view_lines);
+        free(this->view_labels);
+        this->view_data = nullptr;
+        this->view_buffer = nullptr;
+        this->view_lines = nullptr;
+        this->view_labels = nullptr;
+        this->view_label_count = 0;
+    } else {
+        for (int i = 0; i < this->line_count; i++)
+            line_pool.destroy(this->lines[i]);
+        line_pool.clear();
+    }
     this->line_pos = 0;
     this->line_count = 0;
 }
@@ -112,15 +130,25 @@ void TextWindow::Append(const char *line) {
     this->lines[this->line_count][str_width] = 0; */
 
     if (this->line_count >= MAX_TEXT_WINDOW_LINES) return;
-    this->lines[this->line_count++] = new DynString(line);
+    this->lines[this->line_count++] = line_pool.create(line);
+}
+
+void TextWindow::Append(const char *line, size_t length) {
+    if (this->line_count >= MAX_TEXT_WINDOW_LINES) return;
+    this->lines[this->line_count++] = line_pool.create(line, length);
+}
+
+void TextWindow::Append(const DynString &line) {
+    if (this->line_count >= MAX_TEXT_WINDOW_LINES) return;
+    this->lines[this->line_count++] = line_pool.create(line);
 }
 
-void TextWindow::Append(const DynString line) {
+void TextWindow::Append(DynString &&line) {
     if (this->line_count >= MAX_TEXT_WINDOW_LINES) return;
-    this->lines[this->line_count++] = new DynString(line);
+    this->lines[this->line_count++] = line_pool.create(std::move(line));
 }
 
-void TextWindow::DrawLine(int16_t lpos, bool withoutFormatting, bool viewingFile) {
+void TextWindow::DrawLine(int32_t lpos, bool withoutFormatting, bool viewingFile) {
 	int line_y;
 	int text_x, text_width;
 	int text_color;
@@ -137,29 +165,37 @@ void TextWindow::DrawLine(int16_t lpos, bool withoutFormatting, bool viewingFile
 
     bool is_boundary, draw_arrow = false;
     const char *str = NULL;
+    size_t str_len = 0;
 
 	if (lpos >= 0 && lpos < line_count) {
-        str = lines[lpos]->c_str();
+        str = GetLine(lpos, str_len);
         const char *tmp = NULL;
 
-		if (!withoutFormatting) switch (str[0]) {
+		if (!withoutFormatting && str_len > 0) switch (str[0]) {
 			case '!':
-				tmp = strchr(str, ';');
-				if (tmp != NULL) str = tmp + 1;
+				tmp = (const char*) memchr(str, ';', str_len);
+				if (tmp != NULL) {
+					str_len -= tmp + 1 - str;
+					str = tmp + 1;
+				}
 				draw_arrow = true;
 				text_x += 5;
 				text_color = color | 0x0F;
 				break;
 			case ':':
-				tmp = strchr(str, ';');
-				if (tmp != NULL) str = tmp + 1;
+				tmp = (const char*) memchr(str, ';', str_len);
+				if (tmp != NULL) {
+					str_len -= tmp + 1 - str;
+					str = tmp + 1;
+				}
 				text_color = color | 0x0F;
 				break;
 			case '$':
 				str++;
+				str_len--;
 				text_color = color | 0x0F;
 				// (window_width - 8 - strlen(str)) / 2
-				text_x = (text_width - 2 - strlen(str)) >> 1;
+				text_x = (text_width - 2 - (int) str_len) >> 1;
 				break;
 		}
     }
@@ -170,7 +206,7 @@ void TextWindow::DrawLine(int16_t lpos, bool withoutFormatting, bool viewingFile
                 driver->draw_char(window_x + 4 + i + text_x, line_y, color | 0x0D, '\x10');
             } else {
                 driver->draw_char(window_x + 4 + i + text_x, line_y, text_color,
-                    (i >= 0 && i < strlen(str)) ? str[i] : ' ');
+                    (i >= 0 && (size_t) i < str_len) ? str[i] : ' ');
             }
         }
     } else {
@@ -206,14 +242,19 @@ void TextWindow::Select(bool hyperlinkAsSelect, bool viewingFile) {
     do {
         driver->idle(IMUntilFrame);
         driver->update_input();
-        int16_t new_line_pos = line_pos;
+        int32_t new_line_pos = line_pos;
         if (driver->deltaY != 0) {
             new_line_pos += driver->deltaY;
         } else if (driver->shiftPressed || driver->keyPressed == KeyEnter) {
             driver->shiftAccepted = true;
-            if (lines[line_pos]->length() > 0 && (*lines[line_pos])[0] == '!') {
+            size_t str_len;
+            const char *str = GetLine(line_pos, str_len);
+            if (str_len > 0 && str[0] == '!') {
                 sstring<20> pointerStr;
-                StrCopy(pointerStr, (lines[line_pos]->c_str()) + 1);
+                size_t pointer_len = str_len - 1;
+                if (pointer_len > StrSize(pointerStr)) pointer_len = StrSize(pointerStr);
+                memcpy(pointerStr, str + 1, pointer_len);
+                pointerStr[pointer_len] = 0;
 
                 char *divPos = strchr(pointerStr, ';');
                 if (divPos != NULL) {
@@ -222,7 +263,7 @@ void TextWindow::Select(bool hyperlinkAsSelect, bool viewingFile) {
 
                 if (pointerStr[0] == '-') {
                     Clear();
-                    OpenFile(pointerStr + 1, false);
+                    ViewFile(pointerStr + 1, false);
                     if (line_count == 0) {
                         return;
                     } else {
@@ -236,25 +277,12 @@ void TextWindow::Select(bool hyperlinkAsSelect, bool viewingFile) {
                     if (hyperlinkAsSelect) {
                         StrCopy(hyperlink, pointerStr);
                     } else {
-                        sstring<21> label;
-                        StrJoin(label, 2, ":", pointerStr);
-                        int label_len = StrLength(label);
-                        for (int i = 0; i < line_count; i++) {
-                            if (label_len == lines[i]->length()) {
-                                bool match = true;
-                                for (int ic = 0; ic < label_len; ic++) {
-                                    if (UpCase(label[ic]) != UpCase((*lines[i])[ic])) {
-                                        match = false;
-                                        break;
-                                    }
-                                }
-                                if (match) {
-                                    new_line_pos = i;
-                                    driver->keyPressed = 0;
-                                    driver->shiftPressed = false;
-                                    goto LabelMatched;
-                                }
-                            }
+                        int32_t label_pos = FindLabel(pointerStr);
+                        if (label_pos >= 0) {
+                            new_line_pos = label_pos;
+                            driver->keyPressed = 0;
+                            driver->shiftPressed = false;
+                            goto LabelMatched;
                         }
                     }
                 }
@@ -287,7 +315,9 @@ void TextWindow::Select(bool hyperlinkAsSelect, bool viewingFile) {
             line_pos = new_line_pos;
             Draw(false, viewingFile);
 
-            if (lines[line_pos]->length() > 0 && (*lines[line_pos])[0] == '!') {
+            size_t str_len;
+            const char *str = GetLine(line_pos, str_len);
+            if (str_len > 0 && str[0] == '!') {
                 DrawTitle(color | 0x0E, hyperlinkAsSelect
                     ? "\xAEPress ENTER to select this\xAF"
                     : "\xAEPress ENTER for more info\xAF"
@@ -305,9 +335,36 @@ void TextWindow::Select(bool hyperlinkAsSelect, bool viewingFile) {
     }
 }
 
-int16_t TextWindow::Edit_DeleteCurrLine(void) {
+int32_t TextWindow::FindLabel(const char *name) {
+    sstring<21> label;
+    StrJoin(label, 2, ":", name);
+    size_t label_len = StrLength(label);
+
+    int32_t count = view_data != nullptr ? view_label_count : line_count;
+    for (int32_t i = 0; i < count; i++) {
+        int32_t lpos = view_data != nullptr ? view_labels[i] : i;
+        size_t str_len;
+        const char *str = GetLine(lpos, str_len);
+        if (label_len == str_len) {
+            bool match = true;
+            for (size_t ic = 0; ic < label_len; ic++) {
+                if (UpCase(label[ic]) != UpCase(str[ic])) {
+                    match = false;
+                    break;
+                }
+            }
+            if (match) {
+                return lpos;
+            }
+        }
+    }
+
+    return -1;
+}
+
+int32_t TextWindow::Edit_DeleteCurrLine(void) {
     if (line_count > 1) {
-        delete lines[line_pos];
+        line_pool.destroy(lines[line_pos]);
         for (int i = line_pos + 1; i < line_count; i++) {
             lines[i - 1] = lines[i];
         }
@@ -319,8 +376,8 @@ int16_t TextWindow::Edit_DeleteCurrLine(void) {
             return line_pos;
         }
     } else {
-        delete lines[0];
-        lines[0] = new DynString();
+        line_pool.destroy(lines[0]);
+        lines[0] = line_pool.create();
         return line_pos;
     }
 }
@@ -348,7 +405,7 @@ void TextWindow::Edit(void) {
         }
 
         driver->read_wait_key();
-        int16_t new_line_pos = line_pos;
+        int32_t new_line_pos = line_pos;
         if (driver->joy_button_pressed(JoyButtonL, false)) {
             new_line_pos = line_pos - PageMoveHeightLines();
         }
@@ -389,9 +446,9 @@ void TextWindow::Edit(void) {
                     }
 
                     DynString *s = lines[line_pos];
-                    lines[line_pos + 1] = new DynString(char_pos >= s->length() ? "" : s->substr(char_pos, lines[line_pos]->length() - char_pos));
-                    lines[line_pos] = new DynString(s->substr(0, char_pos));
-                    delete s;
+                    lines[line_pos + 1] = line_pool.create(char_pos >= s->length() ? "" : s->substr(char_pos, lines[line_pos]->length() - char_pos));
+                    lines[line_pos] = line_pool.create(s->substr(0, char_pos));
+                    line_pool.destroy(s);
 
                     new_line_pos = line_pos + 1;
                     char_pos = 0;
@@ -401,10 +458,10 @@ void TextWindow::Edit(void) {
             case KeyBackspace: {
                 if (char_pos > 0) {
                     DynString *s = lines[line_pos];
-                    lines[line_pos] = new DynString(
+                    lines[line_pos] = line_pool.create(
                         s->substr(0, char_pos - 1) + s->substr(char_pos, s->length() - char_pos)
                     );
-                    delete s;
+                    line_pool.destroy(s);
                     char_pos--;
                 } else if (lines[line_pos]->length() == 0) {
                     Edit_DeleteCurrLine();
@@ -419,15 +476,15 @@ void TextWindow::Edit(void) {
                 if (lines[line_pos]->length() > 0) {
                     DynString *s = lines[line_pos];
                     if (char_pos < lines[line_pos]->length()) {
-                        lines[line_pos] = new DynString(
+                        lines[line_pos] = line_pool.create(
                             s->substr(0, char_pos) + s->substr(char_pos + 1, s->length() - char_pos - 1)
                         );
                     } else {
-                        lines[line_pos] = new DynString(
+                        lines[line_pos] = line_pool.create(
                             s->substr(0, char_pos) 
                         );
                     }
-                    delete s;
+                    line_pool.destroy(s);
                 }
             } break;
             case KeyCtrlY: {
@@ -438,30 +495,30 @@ void TextWindow::Edit(void) {
                     if (!insert_mode) {
                         DynString *s = lines[line_pos];
                         if (char_pos < s->length()) {
-                            lines[line_pos] = new DynString(
+                            lines[line_pos] = line_pool.create(
                                 s->substr(0, char_pos) + ((char) driver->keyPressed) + s->substr(char_pos, s->length() - char_pos)
                             );
                         } else {
-                            lines[line_pos] = new DynString(
+                            lines[line_pos] = line_pool.create(
                                 s->substr(0, char_pos) + ((char) driver->keyPressed)
                             );
                         }
-                        delete s;
+                        line_pool.destroy(s);
 
                         char_pos++;
                     } else {
                         if (lines[line_pos]->length() < (window_width - 8)) {
                             DynString *s = lines[line_pos];
                             if ((char_pos + 1) < s->length()) {
-                                lines[line_pos] = new DynString(
+                                lines[line_pos] = line_pool.create(
                                     s->substr(0, char_pos) + ((char) driver->keyPressed) + s->substr(char_pos + 1, s->length() - char_pos - 1)
                                 );
                             } else {
-                                lines[line_pos] = new DynString(
+                                lines[line_pos] = line_pool.create(
                                     s->substr(0, char_pos) + ((char) driver->keyPressed)
                                 );
                             }
-                            delete s;
+                            line_pool.destroy(s);
 
                             char_pos++;
                         }
@@ -482,14 +539,12 @@ void TextWindow::Edit(void) {
     } while (driver->keyPressed != KeyEscape);
 
     if (lines[line_count - 1]->length() == 0) {
-        delete lines[line_count - 1];
+        line_pool.destroy(lines[line_count - 1]);
         line_count--;
     }
 }
 
-void TextWindow::OpenFile(const char *filename, bool errorIfMissing) {
-    sstring<255> filename_joined;
-
+static void help_filename(char (&filename_joined)[256], const char *filename) {
     if (filename[0] == '*') {
         filename++;
     }
@@ -498,6 +553,11 @@ void TextWindow::OpenFile(const char *filename, bool errorIfMissing) {
     } else {
         StrCopy(filename_joined, filename);
     }
+}
+
+void TextWindow::OpenFile(const char *filename, bool errorIfMissing) {
+    sstring<255> filename_joined;
+    help_filename(filename_joined, filename);
 
     Clear();
     {
@@ -538,10 +598,111 @@ void TextWindow::OpenFile(const char *filename, bool errorIfMissing) {
     }
 }
 
+void TextWindow::ViewFile(const char *filename, bool errorIfMissing) {
+    sstring<255> filename_joined;
+    help_filename(filename_joined, filename);
+
+    Clear();
+
+    IOStream *stream = filesystem->open_file(filename_joined, false);
+    const char *data = nullptr;
+    size_t len = 0;
+    if (!stream->errored()) {
+        // memory-backed (romfs) files outlive their streams, as with
+        // stat code in the world deserializer, and are indexed in place
+        data = (const char*) stream->ptr();
+        len = stream->remaining();
+        if (data == nullptr) {
+            // otherwise, read the whole file at once
+            bool sized = len != (size_t) -1;
+            size_t capacity = (sized && len > 0) ? len : 4096;
+            len = 0;
+            view_buffer = (char*) malloc(capacity);
+            while (view_buffer != nullptr) {
+                len += stream->read((uint8_t*) (view_buffer + len), capacity - len);
+                if (sized || len < capacity || stream->eof() || stream->errored()) break;
+
+                char *new_buffer = (char*) realloc(view_buffer, capacity * 2);
+                if (new_buffer == nullptr) {
+                    free(view_buffer);
+                    view_buffer = nullptr;
+                    break;
+                }
+                view_buffer = new_buffer;
+                capacity *= 2;
+            }
+            data = view_buffer;
+        }
+    }
+
+    if (data == nullptr || (stream->errored() && !stream->eof())) {
+        free(view_buffer);
+        view_buffer = nullptr;
+        delete stream;
+        if (errorIfMissing) {
+            sstring<255> error;
+            StrJoin(error, 2, "Error reading ", filename_joined);
+            Append(error);
+        }
+        return;
+    }
+    delete stream;
+
+    // index the line spans; lines end with CR, LF or CR LF, and
+    // a trailing line without one is kept only if non-empty
+    size_t max_lines = 1;
+    for (size_t i = 0; i < len; i++) {
+        if (data[i] == '\r' || data[i] == '\n') max_lines++;
+    }
+    if (max_lines > INT32_MAX) max_lines = INT32_MAX;
+    view_lines = (TextWindowLine*) malloc(sizeof(TextWindowLine) * max_lines);
+    if (view_lines == nullptr) {
+        free(view_buffer);
+        view_buffer = nullptr;
+        return;
+    }
+
+    int32_t label_count = 0;
+    size_t pos = 0;
+    while (pos < len && (size_t) line_count < max_lines) {
+        size_t start = pos;
+        while (pos < len && data[pos] != '\r' && data[pos] != '\n') {
+            pos++;
+        }
+        size_t end = pos;
+        if (pos < len) {
+            if (data[pos] == '\r' && (pos + 1) < len && data[pos + 1] == '\n') pos++;
+            pos++;
+        } else if (end == start) {
+            break;
+        }
+        view_lines[line_count].offset = start;
+        view_lines[line_count].length = end - start;
+        if (end > start && data[start] == ':') label_count++;
+        line_count++;
+    }
+
+    if (label_count > 0) {
+        view_labels = (int32_t*) malloc(sizeof(int32_t) * label_count);
+        if (view_labels != nullptr) {
+            for (int32_t i = 0; i < line_count; i++) {
+                if (view_lines[i].length > 0 && data[view_lines[i].offset] == ':') {
+                    view_labels[view_label_count++] = i;
+                }
+            }
+        }
+    }
+
+    view_data = data;
+    if (line_count == 0) {
+        Clear();
+    }
+}
+
 void TextWindow::SaveFile(const char *filename) {
     IOStream *stream = filesystem->open_file(filename, true);
     for (int i = 0; i < line_count; i++) {
-        stream->write_cstring((const char *) lines[i], false);
+        stream->write_cstring(lines[i]->c_str(), false);
         stream->write8('\r');
         stream->write8('\n');
     }
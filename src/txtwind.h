@@ -4,6 +4,7 @@
 #include <cstdint>
 #include "filesystem.h"
 #include "driver.h"
+#include "utils/arena.h"
 #include "utils/stringutils.h"
 
 #define MAX_TEXT_WINDOW_LINES 1024
@@ -17,6 +18,11 @@ namespace ZZT {
         WinPatSeparator
     } WindowPatternType;
 
+    struct TextWindowLine {
+        uint32_t offset;
+        uint32_t length;
+    };
+
     class TextWindow {
     private:
         void DrawBorderLine(int16_t y, WindowPatternType ptype);
@@ -25,17 +31,27 @@ namespace ZZT {
         Driver *driver;
         FilesystemDriver *filesystem;
 		int16_t window_x, window_y, window_width, window_height;
+        Pool<DynString> line_pool;
+
+        // ViewFile() state: lines are spans of view_data, which is either
+        // the stream's own memory or view_buffer, a copy of the file.
+        const char *view_data;
+        char *view_buffer;
+        TextWindowLine *view_lines;
+        int32_t *view_labels; // lines starting with ':'
+        int32_t view_label_count;
 
         int PageMoveHeightLines(void);
         void DrawTitle(uint8_t color, const char *title);
-        void DrawLine(int16_t lpos, bool withoutFormatting, bool viewingFile);
-        int16_t Edit_DeleteCurrLine(void);
+        void DrawLine(int32_t lpos, bool withoutFormatting, bool viewingFile);
+        int32_t Edit_DeleteCurrLine(void);
+        int32_t FindLabel(const char *name);
 
     public:
         bool selectable;
         uint8_t color;
-        int16_t line_count;
-        int16_t line_pos;
+        int32_t line_count;
+        int32_t line_pos;
         DynString **lines;
         sstring<20> hyperlink;
         sstring<50> title;
@@ -51,12 +67,28 @@ namespace ZZT {
         virtual void DrawClose(void);
         virtual void Draw(bool withoutFormatting, bool viewingFile);
         void Append(const char *line);
-        void Append(const DynString line);
+        void Append(const char *line, size_t length);
+        void Append(const DynString &line);
+        void Append(DynString &&line);
         void Select(bool hyperlinkAsSelect, bool viewingFile);
         void Edit(void);
         void OpenFile(const char *filename, bool errorIfMissing);
+        // Opens a file read-only, without copying it into lines and
+        // without a line limit. Edit, Sort and SaveFile do not apply.
+        void ViewFile(const char *filename, bool errorIfMissing);
         void SaveFile(const char *filename);
         void Sort(int16_t start, int16_t count);
+
+        // Not NUL-terminated when viewing a file.
+        inline const char *GetLine(int32_t idx, size_t &length) const {
+            if (view_data != nullptr) {
+                length = view_lines[idx].length;
+                return view_data + view_lines[idx].offset;
+            } else {
+                length = lines[idx]->length();
+                return lines[idx]->c_str();
+            }
+        }
     };
 
     void TextWindowDrawPattern(Driver *driver, int16_t x, int16_t y, int16_t width, uint8_t color, WindowPatternType ptype);
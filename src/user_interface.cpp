@@ -368,7 +368,7 @@ void UserInterface::ConfigureViewport(int16_t &x, int16_t &y, int16_t &width, in
 void UserInterface::DisplayFile(FilesystemDriver *filesystem, const char *filename, const char *title) {
     TextWindow *window = CreateTextWindow(filesystem);
     StrCopy(window->title, title);
-    window->OpenFile(filename, false);
+    window->ViewFile(filename, false);
     if (window->line_count > 0) {
 	    window->selectable = false;
         window->DrawOpen();
@@ -0,0 +1,140 @@
+#ifndef __UTILS_ARENA_H__
+#define __UTILS_ARENA_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <utility>
+
+#define ARENA_DEFAULT_CHUNK_SIZE 4096
+
+namespace ZZT {
+
+    // Bump allocator for memory which is released all at once. Chunks are
+    // kept when the arena is cleared, so refilling it to a similar size
+    // does not allocate again.
+    class Arena {
+        struct Chunk {
+            Chunk *next;
+            size_t size, used;
+        };
+
+        static constexpr size_t align = alignof(std::max_align_t);
+        static constexpr size_t header_size = (sizeof(Chunk) + align - 1) & ~(align - 1);
+
+        Chunk *first, *current;
+        size_t chunk_size;
+
+        inline uint8_t *chunk_data(Chunk *chunk) {
+            return ((uint8_t*) chunk) + header_size;
+        }
+
+        void *alloc_chunk(size_t size) {
+            // reuse the chunks kept by clear(), skipping ones too small
+            Chunk *prev = current;
+            Chunk *chunk = current != nullptr ? current->next : first;
+            while (chunk != nullptr && chunk->size < size) {
+                prev = chunk;
+                chunk = chunk->next;
+            }
+
+            if (chunk == nullptr) {
+                size_t new_size = size > chunk_size ? size : chunk_size;
+                chunk = (Chunk*) malloc(header_size + new_size);
+                if (chunk == nullptr) return nullptr;
+                chunk->size = new_size;
+                chunk->next = nullptr;
+                if (prev != nullptr) {
+                    chunk->next = prev->next;
+                    prev->next = chunk;
+                } else {
+                    first = chunk;
+                }
+            }
+
+            chunk->used = size;
+            current = chunk;
+            return chunk_data(chunk);
+        }
+
+    public:
+        Arena(): Arena(ARENA_DEFAULT_CHUNK_SIZE) { }
+        Arena(size_t chunk_size): first(nullptr), current(nullptr), chunk_size(chunk_size) { }
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+
+        ~Arena() {
+            Chunk *chunk = first;
+            while (chunk != nullptr) {
+                Chunk *next = chunk->next;
+                free(chunk);
+                chunk = next;
+            }
+        }
+
+        // Returns nullptr if out of memory.
+        inline void *alloc(size_t size) {
+            size = (size + align - 1) & ~(align - 1);
+            if (current != nullptr && (current->size - current->used) >= size) {
+                void *ptr = chunk_data(current) + current->used;
+                current->used += size;
+                return ptr;
+            }
+            return alloc_chunk(size);
+        }
+
+        // Invalidates everything allocated so far.
+        void clear(void) {
+            for (Chunk *chunk = first; chunk != nullptr; chunk = chunk->next) {
+                chunk->used = 0;
+            }
+            current = nullptr;
+        }
+    };
+
+    // Objects of one type, allocated from an arena; destroyed objects'
+    // slots are reused.
+    template<typename T>
+    class Pool {
+        union Slot {
+            Slot *next;
+            alignas(T) uint8_t data[sizeof(T)];
+        };
+
+        Arena arena;
+        Slot *free_slots;
+
+    public:
+        Pool(): Pool(ARENA_DEFAULT_CHUNK_SIZE) { }
+        Pool(size_t chunk_size): arena(chunk_size), free_slots(nullptr) { }
+
+        template<typename... Args>
+        T *create(Args&&... args) {
+            Slot *slot = free_slots;
+            if (slot != nullptr) {
+                free_slots = slot->next;
+            } else {
+                slot = (Slot*) arena.alloc(sizeof(Slot));
+                if (slot == nullptr) return nullptr;
+            }
+            return new (slot->data) T(std::forward<Args>(args)...);
+        }
+
+        void destroy(T *object) {
+            if (object == nullptr) return;
+            object->~T();
+            Slot *slot = (Slot*) object;
+            slot->next = free_slots;
+            free_slots = slot;
+        }
+
+        // Only once every object has been destroyed.
+        void clear(void) {
+            arena.clear();
+            free_slots = nullptr;
+        }
+    };
+}
+
+#endif
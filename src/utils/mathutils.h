@@ -13,6 +13,7 @@ public:
         Random(uint32_t s): seed(s) { };
 
         void SetSeed(uint32_t s);
+        uint32_t GetSeed(void) const { return seed; }
         int16_t Next(int16_t max);
     };
 
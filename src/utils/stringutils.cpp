@@ -1,52 +1,89 @@
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <utility>
 #include "stringutils.h"
 
 namespace ZZT {
 
-    DynString::DynString() {
-        set_length(0);
+    DynString::DynString(): data(local), len(0), capacity(DYNSTRING_LOCAL_SIZE - 1) {
+        local[0] = 0;
     }
 
-    void DynString::set_length(size_t l) {
-        if (l > 255) {
-            len = 255;
-        } else {
-            len = l;
-        }
-        data = (char*) malloc(sizeof(char) * (len + 1));
-        data[len] = 0;
+    DynString::DynString(const char *s): DynString() {
+        append(s, strlen(s));
     }
 
-    DynString::DynString(const char *s) {
-        size_t l = strlen(s);
-        set_length(l);
-        strncpy(data, s, len);
+    DynString::DynString(const char *s, size_t length): DynString() {
+        append(s, length);
     }
 
-    DynString::DynString(const DynString &other) {
-        set_length(other.len);
-        memcpy(data, other.data, len);
+    DynString::DynString(const DynString &other): DynString() {
+        append(other.data, other.len);
     }
 
-    DynString::DynString(size_t length) {
-        set_length(length);
+    DynString::DynString(DynString &&other): DynString() {
+        *this = std::move(other);
     }
 
     DynString::~DynString() {
-        free(data);
+        if (!is_local()) {
+            free(data);
+        }
         data = nullptr;
     }
 
+    void DynString::reserve(size_t new_capacity) {
+        if (new_capacity > DYNSTRING_MAX_LENGTH) new_capacity = DYNSTRING_MAX_LENGTH;
+        if (new_capacity <= capacity) return;
+
+        // grow geometrically, so that appending in a loop stays linear
+        size_t grown = (size_t) capacity * 2;
+        if (new_capacity < grown) {
+            new_capacity = grown > DYNSTRING_MAX_LENGTH ? DYNSTRING_MAX_LENGTH : grown;
+        }
+
+        char *new_data = (char*) malloc(sizeof(char) * (new_capacity + 1));
+        if (new_data == nullptr) return;
+        memcpy(new_data, data, len + 1);
+        if (!is_local()) {
+            free(data);
+        }
+        data = new_data;
+        capacity = new_capacity;
+    }
+
+    DynString& DynString::append(const char *s, size_t length) {
+        if (length > (size_t) (capacity - len)) {
+            reserve(len + length);
+            if (length > (size_t) (capacity - len)) length = capacity - len;
+        }
+        memcpy(data + len, s, length);
+        len += length;
+        data[len] = 0;
+        return *this;
+    }
+
+    DynString& DynString::append(char c) {
+        if (len >= capacity) {
+            reserve(len + 1);
+            if (len >= capacity) return *this;
+        }
+        data[len++] = c;
+        data[len] = 0;
+        return *this;
+    }
+
+    void DynString::clear(void) {
+        len = 0;
+        data[0] = 0;
+    }
+
     DynString& DynString::operator=(const DynString& other) {
         // copy
         if (this != &other) {
-            if (len != other.len) {
-                free(data);
-                set_length(other.len);
-            }
-            memcpy(data, other.data, len);
+            clear();
+            append(other.data, other.len);
         }
         return *this;
     }
@@ -54,54 +91,56 @@ namespace ZZT {
     DynString& DynString::operator=(DynString&& other) {
         // move
         if (this != &other) {
-            if (len != other.len) {
-                free(data);
-                set_length(other.len);
-                memcpy(data, other.data, len);
-                free(other.data);
-                other.data = nullptr;
+            if (other.is_local()) {
+                clear();
+                append(other.data, other.len);
             } else {
+                if (!is_local()) {
+                    free(data);
+                }
                 data = other.data;
-                other.data = nullptr;
+                len = other.len;
+                capacity = other.capacity;
+                other.data = other.local;
+                other.capacity = DYNSTRING_LOCAL_SIZE - 1;
             }
+            other.clear();
         }
         return *this;
     }
 
-    DynString DynString::operator+(const DynString &rhs) {
-        DynString result = DynString(len + rhs.len);
-        memcpy(result.data, data, len);
-        memcpy(result.data + len, rhs.data, result.len - len);
+    DynString DynString::operator+(const DynString &rhs) const {
+        DynString result;
+        result.reserve(len + rhs.len);
+        result.append(data, len);
+        result.append(rhs.data, rhs.len);
         return result;
     }
 
-    DynString DynString::operator+(const char *rhs) {
+    DynString DynString::operator+(const char *rhs) const {
         size_t rhs_len = strlen(rhs);
-        DynString result = DynString(len + rhs_len);
-        memcpy(result.data, data, len);
-        memcpy(result.data + len, rhs, result.len - len);
+        DynString result;
+        result.reserve(len + rhs_len);
+        result.append(data, len);
+        result.append(rhs, rhs_len);
         return result;
     }
 
-    DynString DynString::operator+(char rhs) {
-        if (len >= 255) return *this;
-
-        DynString result = DynString(len + 1);
-        memcpy(result.data, data, len);
-        result.data[len] = rhs;
+    DynString DynString::operator+(char rhs) const {
+        DynString result;
+        result.reserve(len + 1);
+        result.append(data, len);
+        result.append(rhs);
         return result;
     }
 
-    DynString DynString::substr(size_t from, size_t length) {
+    DynString DynString::substr(size_t from, size_t length) const {
         if (length <= 0 || from >= len) {
             return DynString();
         }
 
-        if (from < 0) from = 0;
         if (length > (len - from)) length = len - from;
-        DynString result = DynString(length);
-        memcpy(result.data, data + from, result.len);
-        return result;
+        return DynString(data + from, length);
     }
 
 }
@@ -90,27 +90,63 @@ namespace ZZT {
 
     // Dynamic strings
 
+    // Strings shorter than this are kept inline, without allocating.
+#define DYNSTRING_LOCAL_SIZE 48
+#define DYNSTRING_MAX_LENGTH 65534
+
     class DynString {
     private:
-        uint8_t len;
         char *data;
+        uint16_t len;
+        uint16_t capacity; // excluding the terminator
+        char local[DYNSTRING_LOCAL_SIZE];
 
-        void set_length(size_t new_len);
-        DynString(size_t length);
+        inline bool is_local() const {
+            return data == local;
+        }
 
     public:
         DynString();
         DynString(const char *s);
+        DynString(const char *s, size_t length);
         DynString(const DynString &other);
+        DynString(DynString &&other);
 
         ~DynString();
 
         DynString& operator=(const DynString& other);
         DynString& operator=(DynString&& other);
-        DynString operator+(const DynString &rhs);
-        DynString operator+(const char *rhs);
-        DynString operator+(char rhs);
-        DynString substr(size_t from, size_t length);
+        DynString operator+(const DynString &rhs) const;
+        DynString operator+(const char *rhs) const;
+        DynString operator+(char rhs) const;
+        DynString substr(size_t from, size_t length) const;
+
+        // Appending past DYNSTRING_MAX_LENGTH, or past what can be
+        // allocated, truncates the string.
+        void reserve(size_t new_capacity);
+        DynString& append(const char *s, size_t length);
+        DynString& append(char c);
+        void clear(void);
+
+        inline DynString& append(const char *s) {
+            return append(s, strlen(s));
+        }
+
+        inline DynString& append(const DynString &s) {
+            return append(s.data, s.len);
+        }
+
+        inline DynString& operator+=(const DynString &rhs) {
+            return append(rhs);
+        }
+
+        inline DynString& operator+=(const char *rhs) {
+            return append(rhs);
+        }
+
+        inline DynString& operator+=(char rhs) {
+            return append(rhs);
+        }
 
         inline const char* c_str() const {
             return data;
@@ -236,9 +236,9 @@ bool SerializerFormatZZT::deserialize_board(Board &board, IOStream &stream, bool
         }
 
         if (len < 0) {
-            stat.data = board.stats[-len].data;
+            stat.data.bind(board.stats[-len].data);
         } else {
-            stat.data.alloc_data(len);
+            stat.data.alloc_data(len, &board.arena);
             if (len > 0) {
 #ifdef ROM_POINTERS
                 if (packed) {
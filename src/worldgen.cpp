@@ -0,0 +1,591 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "filesystem_posix.h"
+#include "world_serializer.h"
+#include "gamevars.h"
+
+/*
+  Stress world generator: writes .ZZT and .SZT worlds made of worst-case
+  boards, for benchmarking and capacity testing. Boards are built and saved
+  with the engine's own board, world and serializer code.
+
+  Board 0 is a title board; the others cycle through the selected
+  scenarios:
+
+    objects      every stat slot filled with objects running a long program
+                 with deep label sets, bound to one another; one of them
+                 broadcasts to all of them
+    pushers      conveyor fields, and boulder and slider chains spanning the
+                 board, pushed from both ends
+    bullets      fast spinning guns in a storm of bullets and ricochets
+    centipedes   long centipede chains filling the stat list
+    duplicators  rows of duplicators copying boulders as fast as they can
+    dark         a dark board of mixed terrain and wandering objects (ZZT only)
+
+  The player starts in a small walled room in the top left corner of every
+  board. The output only depends on the seed and the options.
+*/
+
+using namespace ZZT;
+
+#define WORLDGEN_MAX_BOARDS 255
+// the original engines refuse to load larger boards
+#define WORLDGEN_DEFAULT_BOARD_LIMIT 20000
+#define WORLDGEN_CENTIPEDE_LENGTH 24
+
+typedef enum {
+    ScenarioObjects,
+    ScenarioPushers,
+    ScenarioBullets,
+    ScenarioCentipedes,
+    ScenarioDuplicators,
+    ScenarioDark,
+    ScenarioCount
+} Scenario;
+
+static const char *scenario_names[ScenarioCount] = {
+    "objects", "pushers", "bullets", "centipedes", "duplicators", "dark"
+};
+
+struct WorldGenOptions {
+    const char *output_name;
+    WorldFormat format;
+    uint32_t seed;
+    int16_t boards;
+    uint32_t board_limit;
+    bool scenarios[ScenarioCount];
+};
+
+class WorldGenerator {
+    Game &game;
+    const WorldGenOptions &options;
+    Random random;
+
+    inline Board &board(void) { return game.board; }
+
+    inline Tile tile(ElementType type, uint8_t color) {
+        return {.element = game.elementId(type), .color = color};
+    }
+
+    inline bool is_empty(int16_t x, int16_t y) {
+        return board().tiles.get(x, y).element == EEmpty;
+    }
+
+    void begin_board(const char *name);
+    int16_t add_stat(int16_t x, int16_t y, ElementType type, uint8_t color, int16_t cycle, const Stat &tpl);
+    void build_program(StatData &data, int32_t max_len, bool broadcast);
+
+    void generate_title(void);
+    void generate_objects(void);
+    void generate_pushers(void);
+    void generate_bullets(void);
+    void generate_centipedes(void);
+    void generate_duplicators(void);
+    void generate_dark(void);
+
+public:
+    WorldGenerator(Game &game, const WorldGenOptions &options);
+
+    bool generate_board(int16_t board_id, Scenario scenario);
+};
+
+// The player's room spans (2, 2) - (6, 6); scenarios keep clear of it.
+static inline bool in_player_room(int16_t x, int16_t y) {
+    return x <= 7 && y <= 7;
+}
+
+WorldGenerator::WorldGenerator(Game &game, const WorldGenOptions &options)
+    : game(game), options(options) {
+
+}
+
+void WorldGenerator::begin_board(const char *name) {
+    board().stats.clear();
+    game.BoardCreate();
+    StrCopy(board().name, name);
+
+    Stat &player = board().stats[0];
+    board().tiles.set(player.x, player.y, {.element = EEmpty, .color = 0x00});
+    player.x = 4;
+    player.y = 4;
+    board().tiles.set(player.x, player.y, tile(EPlayer, 0x1F));
+    board().info.start_player_x = player.x;
+    board().info.start_player_y = player.y;
+
+    for (int16_t i = 2; i <= 6; i++) {
+        board().tiles.set(i, 2, tile(ENormal, 0x0E));
+        board().tiles.set(i, 6, tile(ENormal, 0x0E));
+        board().tiles.set(2, i, tile(ENormal, 0x0E));
+        board().tiles.set(6, i, tile(ENormal, 0x0E));
+    }
+}
+
+// Returns the new stat's ID, or -1 once the stat list is full.
+int16_t WorldGenerator::add_stat(int16_t x, int16_t y, ElementType type, uint8_t color, int16_t cycle, const Stat &tpl) {
+    if (board().stats.count >= board().stats.stat_size()) {
+        return -1;
+    }
+    game.AddStat(x, y, game.elementId(type), color, cycle, tpl);
+    return board().stats.count;
+}
+
+// A program which sends itself down a chain of labels. Each label also
+// appears zapped ahead of it, so that every search walks past those first.
+void WorldGenerator::build_program(StatData &data, int32_t max_len, bool broadcast) {
+    char *text = (char*) malloc(max_len);
+    int32_t len = 0;
+    auto append = [&](const char *line, int32_t limit) {
+        int32_t line_len = strlen(line);
+        if (len + line_len > limit) return false;
+        memcpy(text + len, line, line_len);
+        len += line_len;
+        return true;
+    };
+
+    char line[96];
+    append(broadcast ? "@broadcast\r#cycle 1\r:loop\r#all:ping\r#send l0\r" : "@stress\r#cycle 1\r:loop\r#send l0\r", max_len);
+    append(":ping\r#set pinged\r#clear pinged\r#send l0\r", max_len);
+
+    // leave room for the last label
+    int32_t labels = 0;
+    while (true) {
+        snprintf(line, sizeof(line), "'l%d\r'l%d\r:l%d\r#if not blocked e #set f%d\r#clear f%d\r#send l%d\r",
+            labels, labels, labels, labels % 10, labels % 10, labels + 1);
+        if (!append(line, max_len - 24)) break;
+        labels++;
+    }
+    snprintf(line, sizeof(line), ":l%d\r#send loop\r", labels);
+    append(line, max_len);
+
+    data.alloc_data(len);
+    memcpy(data.data, text, len);
+    free(text);
+}
+
+void WorldGenerator::generate_title(void) {
+    begin_board("Stress world");
+}
+
+void WorldGenerator::generate_objects(void) {
+    begin_board("Stress: objects");
+
+    // Everything but the two programs: board header and tiles (taken to be
+    // compressed well), then 33 bytes per stat.
+    int32_t budget = (int32_t) options.board_limit - 2048 - 33 * (board().stats.stat_size() + 1);
+    budget /= 2;
+    if (budget > 16000) budget = 16000;
+    if (budget < 256) budget = 256;
+
+    Stat broadcaster = Stat();
+    Stat bound = Stat();
+    build_program(broadcaster.data, budget, true);
+    build_program(bound.data, budget, false);
+
+    int16_t bound_id = -1;
+    for (int16_t iy = 2; iy < board().height(); iy++) {
+        for (int16_t ix = 2; ix < board().width(); ix++) {
+            if (in_player_room(ix, iy) || ((ix + iy) & 1) != 0) continue;
+            if (board().stats.count == 0) {
+                add_stat(ix, iy, EObject, 0x0E, 1, broadcaster);
+            } else if (bound_id < 0) {
+                bound_id = add_stat(ix, iy, EObject, 0x0F, 1, bound);
+            } else if (add_stat(ix, iy, EObject, 0x0F, 1, Stat()) >= 0) {
+                // bound to the first regular object, as by #bind
+                board().stats[board().stats.count].data.bind(board().stats[bound_id].data);
+            }
+            if (board().stats.count > 0) {
+                board().stats[board().stats.count].p1 = 2 + random.Next(253);
+            }
+        }
+    }
+
+    broadcaster.data.free_data();
+    bound.data.free_data();
+}
+
+void WorldGenerator::generate_pushers(void) {
+    begin_board("Stress: pushers");
+    int16_t width = board().width();
+    int16_t height = board().height();
+    int16_t chain_x = width / 3;
+
+    // conveyors among rubble on the left
+    for (int16_t iy = 3; iy < height; iy++) {
+        for (int16_t ix = 3; ix < chain_x; ix++) {
+            if (in_player_room(ix, iy)) continue;
+            if ((ix % 3) == 0 && (iy % 3) == 0) {
+                ElementType type = ((ix + iy) % 2) == 0 ? EConveyorCW : EConveyorCCW;
+                if (add_stat(ix, iy, type, 0x0B, 3, Stat()) >= 0) continue;
+            }
+            if (random.Next(3) > 0) {
+                board().tiles.set(ix, iy, random.Next(4) == 0 ? tile(EGem, 0x0A) : tile(EBoulder, 0x06));
+            }
+        }
+    }
+
+    // Every other row on the right is one chain of boulders and sliders,
+    // with a pusher on either end and a single gap.
+    Stat east = Stat();
+    east.step_x = 1;
+    Stat west = Stat();
+    west.step_x = -1;
+    for (int16_t iy = 3; iy < height; iy += 2) {
+        int16_t gap = chain_x + 2 + random.Next(width - chain_x - 4);
+        for (int16_t ix = chain_x + 1; ix < width - 1; ix++) {
+            if (ix != gap) {
+                board().tiles.set(ix, iy, random.Next(4) == 0 ? tile(ESliderEW, 0x0F) : tile(EBoulder, 0x06));
+            }
+        }
+        add_stat(chain_x, iy, EPusher, 0x0F, 4, east);
+        add_stat(width - 1, iy, EPusher, 0x0F, 4, west);
+    }
+}
+
+void WorldGenerator::generate_bullets(void) {
+    begin_board("Stress: bullets");
+    int16_t width = board().width();
+    int16_t height = board().height();
+
+    for (int16_t iy = 2; iy < height; iy++) {
+        for (int16_t ix = 2; ix < width; ix++) {
+            if (!in_player_room(ix, iy) && random.Next(100) == 0) {
+                board().tiles.set(ix, iy, tile(ERicochet, 0x0A));
+            }
+        }
+    }
+
+    // fast, smart guns on a grid
+    Stat gun = Stat();
+    gun.p1 = 8;
+    gun.p2 = 8;
+    for (int16_t iy = 4; iy < height - 1; iy += 5) {
+        for (int16_t ix = 10; ix < width - 1; ix += 8) {
+            add_stat(ix, iy, ESpinningGun, 0x0F, 2, gun);
+        }
+    }
+
+    // bullets in every remaining stat slot
+    static const int16_t dirs[4][2] = {{0, -1}, {0, 1}, {-1, 0}, {1, 0}};
+    Stat bullet = Stat();
+    bullet.p1 = ShotSourceEnemy;
+    for (int tries = 0; tries < 10000 && board().stats.count < board().stats.stat_size(); tries++) {
+        int16_t x = 2 + random.Next(width - 2);
+        int16_t y = 2 + random.Next(height - 2);
+        if (in_player_room(x, y) || !is_empty(x, y)) continue;
+        int dir = random.Next(4);
+        bullet.step_x = dirs[dir][0];
+        bullet.step_y = dirs[dir][1];
+        add_stat(x, y, EBullet, 0x0F, 1, bullet);
+    }
+}
+
+void WorldGenerator::generate_centipedes(void) {
+    begin_board("Stress: centipedes");
+    int16_t width = board().width();
+    int16_t height = board().height();
+
+    for (int16_t iy = 2; iy < height; iy++) {
+        for (int16_t ix = 2; ix < width; ix++) {
+            if (!in_player_room(ix, iy) && (iy % 2) == 1 && random.Next(50) == 0) {
+                board().tiles.set(ix, iy, tile(ESolid, 0x0E));
+            }
+        }
+    }
+
+    // chains laid out head first along every other row
+    bool full = false;
+    for (int16_t iy = 8; iy < height && !full; iy += 2) {
+        for (int16_t ix = 3; (ix + WORLDGEN_CENTIPEDE_LENGTH) < width && !full; ix += WORLDGEN_CENTIPEDE_LENGTH + 2) {
+            Stat head = Stat();
+            head.p1 = random.Next(9);
+            head.p2 = random.Next(9);
+            head.step_x = -1;
+            int16_t head_id = add_stat(ix, iy, ECentipedeHead, 0x0C, 2, head);
+            if (head_id < 0) {
+                full = true;
+                break;
+            }
+
+            int16_t prev_id = head_id;
+            for (int16_t i = 1; i < WORLDGEN_CENTIPEDE_LENGTH; i++) {
+                int16_t seg_id = add_stat(ix + i, iy, ECentipedeSegment, 0x0C, 2, Stat());
+                if (seg_id < 0) {
+                    full = true;
+                    break;
+                }
+                board().stats[prev_id].follower = seg_id;
+                board().stats[seg_id].leader = prev_id;
+                prev_id = seg_id;
+            }
+        }
+    }
+}
+
+void WorldGenerator::generate_duplicators(void) {
+    begin_board("Stress: duplicators");
+    int16_t width = board().width();
+    int16_t height = board().height();
+
+    // boulder, duplicator copying it east, two cells to push copies into
+    Stat duplicator = Stat();
+    duplicator.step_x = -1;
+    duplicator.p2 = 8;
+    for (int16_t iy = 3; iy < height; iy += 2) {
+        for (int16_t ix = in_player_room(1, iy) ? 8 : 2; (ix + 3) < width; ix += 4) {
+            board().tiles.set(ix, iy, tile(EBoulder, 0x06));
+            add_stat(ix + 1, iy, EDuplicator, 0x0F, (9 - duplicator.p2) * 3, duplicator);
+        }
+    }
+}
+
+void WorldGenerator::generate_dark(void) {
+    begin_board("Stress: dark");
+    board().info.is_dark = true;
+    int16_t width = board().width();
+    int16_t height = board().height();
+
+    const Tile terrain[] = {
+        tile(ENormal, 0x0E), tile(EBreakable, 0x0B), tile(EForest, 0x20), tile(EWater, 0x9F),
+        tile(ELine, 0x0F), tile(EGem, 0x0D), tile(ETorch, 0x06), tile(EAmmo, 0x03)
+    };
+    for (int16_t iy = 2; iy < height; iy++) {
+        for (int16_t ix = 2; ix < width; ix++) {
+            if (!in_player_room(ix, iy) && random.Next(5) < 2) {
+                board().tiles.set(ix, iy, terrain[random.Next(sizeof(terrain) / sizeof(Tile))]);
+            }
+        }
+    }
+
+    Stat wanderer = Stat();
+    const char *program = "@wanderer\r:a\r?rnd\r#send a\r";
+    wanderer.data.alloc_data(strlen(program));
+    memcpy(wanderer.data.data, program, strlen(program));
+
+    int16_t bound_id = -1;
+    for (int tries = 0; tries < 10000 && board().stats.count < (board().stats.stat_size() / 2); tries++) {
+        int16_t x = 2 + random.Next(width - 2);
+        int16_t y = 2 + random.Next(height - 2);
+        if (in_player_room(x, y) || !is_empty(x, y)) continue;
+        if (bound_id < 0) {
+            bound_id = add_stat(x, y, EObject, 0x0F, 3, wanderer);
+        } else if (add_stat(x, y, EObject, 0x0F, 3, Stat()) >= 0) {
+            board().stats[board().stats.count].data.bind(board().stats[bound_id].data);
+        }
+    }
+    wanderer.data.free_data();
+}
+
+bool WorldGenerator::generate_board(int16_t board_id, Scenario scenario) {
+    random.SetSeed(options.seed + board_id);
+
+    if (board_id == 0) {
+        generate_title();
+    } else switch (scenario) {
+        case ScenarioObjects: generate_objects(); break;
+        case ScenarioPushers: generate_pushers(); break;
+        case ScenarioBullets: generate_bullets(); break;
+        case ScenarioCentipedes: generate_centipedes(); break;
+        case ScenarioDuplicators: generate_duplicators(); break;
+        case ScenarioDark: generate_dark(); break;
+        default: break;
+    }
+
+    // boards are linked west to east, after the title
+    if (board_id > 1) {
+        board().info.neighbor_boards[2] = board_id - 1;
+    }
+    if (board_id > 0 && board_id < (options.boards - 1)) {
+        board().info.neighbor_boards[3] = board_id + 1;
+    }
+
+    // check the size it will have on disk
+    SerializerFormatZZT serializer(options.format);
+    size_t buflen = serializer.estimate_board_size(board());
+    uint8_t *buffer = (uint8_t*) malloc(buflen);
+    MemoryIOStream stream(buffer, buflen, true);
+    serializer.serialize_board(board(), stream, false);
+    size_t len = stream.tell();
+    free(buffer);
+
+    fprintf(stderr, "[worldgen] board %d: %s, %d stats, %u bytes\n", board_id,
+        board_id == 0 ? "title" : scenario_names[scenario], board().stats.count, (uint32_t) len);
+    if (len > 65535) {
+        fprintf(stderr, "[worldgen] board %d is too large to be saved\n", board_id);
+        return false;
+    } else if (len > options.board_limit) {
+        fprintf(stderr, "[worldgen] warning: board %d is over the %u byte limit\n", board_id, options.board_limit);
+    }
+
+    bool result = game.world.write_board(board_id, board());
+    board().stats.free_all_data();
+    return result;
+}
+
+static void print_usage(const char *name) {
+    fprintf(stderr, "Usage: %s [options] <output.zzt|output.szt>\n", name);
+    fprintf(stderr, "  -s <seed>         random seed (default 1)\n");
+    fprintf(stderr, "  -b <boards>       number of boards, including the title board (default: one per scenario)\n");
+    fprintf(stderr, "  -k <a,b,...>      scenarios to cycle through (default: all)\n");
+    fprintf(stderr, "  -l <bytes>        board size to fit programs into (default %d)\n", WORLDGEN_DEFAULT_BOARD_LIMIT);
+    fprintf(stderr, "  -f <zzt|szt>      world format (default: by extension)\n");
+    fprintf(stderr, "Scenarios:");
+    for (int i = 0; i < ScenarioCount; i++) {
+        fprintf(stderr, " %s", scenario_names[i]);
+    }
+    fprintf(stderr, "\n");
+}
+
+static bool parse_scenarios(const char *list, bool *scenarios) {
+    for (int i = 0; i < ScenarioCount; i++) {
+        scenarios[i] = false;
+    }
+
+    while (*list != 0) {
+        size_t len = strcspn(list, ",");
+        bool found = false;
+        for (int i = 0; i < ScenarioCount; i++) {
+            if (strlen(scenario_names[i]) == len && strncmp(list, scenario_names[i], len) == 0) {
+                scenarios[i] = true;
+                found = true;
+            }
+        }
+        if (!found) {
+            return false;
+        }
+        list += len;
+        if (*list == ',') list++;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    WorldGenOptions options = {
+        .output_name = nullptr,
+        .format = WorldFormatAny,
+        .seed = 1,
+        .boards = 0,
+        .board_limit = WORLDGEN_DEFAULT_BOARD_LIMIT
+    };
+    const char *scenario_list = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] == '-' && argv[i][1] != 0 && argv[i][2] == 0) {
+            char opt = argv[i][1];
+            if ((i + 1) < argc) {
+                const char *value = argv[++i];
+                switch (opt) {
+                case 's': options.seed = strtoul(value, nullptr, 10); continue;
+                case 'b': options.boards = atoi(value); continue;
+                case 'k': scenario_list = value; continue;
+                case 'l': options.board_limit = strtoul(value, nullptr, 10); continue;
+                case 'f':
+                    if (strcasecmp(value, "zzt") == 0) {
+                        options.format = WorldFormatZZT;
+                        continue;
+                    } else if (strcasecmp(value, "szt") == 0) {
+                        options.format = WorldFormatSuperZZT;
+                        continue;
+                    }
+                    break;
+                }
+            }
+            print_usage(argv[0]);
+            return 1;
+        } else if (options.output_name == nullptr) {
+            options.output_name = argv[i];
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (options.output_name == nullptr) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    size_t name_len = strlen(options.output_name);
+    if (options.format == WorldFormatAny) {
+        bool szt = name_len > 4 && strcasecmp(options.output_name + name_len - 4, ".szt") == 0;
+        options.format = szt ? WorldFormatSuperZZT : WorldFormatZZT;
+    }
+    bool szzt = options.format == WorldFormatSuperZZT;
+
+    if (scenario_list != nullptr) {
+        if (!parse_scenarios(scenario_list, options.scenarios)) {
+            print_usage(argv[0]);
+            return 1;
+        }
+        if (szzt && options.scenarios[ScenarioDark]) {
+            fprintf(stderr, "[worldgen] Super ZZT has no dark boards\n");
+            return 1;
+        }
+    } else {
+        for (int i = 0; i < ScenarioCount; i++) {
+            options.scenarios[i] = !(szzt && i == ScenarioDark);
+        }
+    }
+
+    Scenario selected[ScenarioCount];
+    int selected_count = 0;
+    for (int i = 0; i < ScenarioCount; i++) {
+        if (options.scenarios[i]) {
+            selected[selected_count++] = (Scenario) i;
+        }
+    }
+    if (selected_count == 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (options.boards <= 0) {
+        options.boards = selected_count + 1;
+    }
+    if (options.boards > WORLDGEN_MAX_BOARDS) {
+        fprintf(stderr, "[worldgen] at most %d boards are supported\n", WORLDGEN_MAX_BOARDS);
+        return 1;
+    }
+
+    Game *game = new Game();
+    game->InitEngine(szzt ? ENGINE_TYPE_SUPER_ZZT : ENGINE_TYPE_ZZT, false);
+    // nothing is shown
+    game->boardDrawSuppressed = true;
+
+    World &world = game->world;
+    memset(&world.info, 0, sizeof(WorldInfo));
+    world.info.health = 100;
+    world.info.ammo = 100;
+    world.info.torches = szzt ? 0 : 100;
+    world.info.current_board = options.boards > 1 ? 1 : 0;
+    {
+        // world name: the file name, without directory or extension
+        const char *base = strrchr(options.output_name, '/');
+        base = base != nullptr ? base + 1 : options.output_name;
+        size_t base_len = strcspn(base, ".");
+        if (base_len >= StrSize(world.info.name)) {
+            base_len = StrSize(world.info.name) - 1;
+        }
+        memcpy(world.info.name, base, base_len);
+        world.info.name[base_len] = 0;
+    }
+
+    WorldGenerator generator(*game, options);
+    for (int16_t i = 0; i < options.boards; i++) {
+        if (!generator.generate_board(i, selected[(i + selected_count - 1) % selected_count])) {
+            return 1;
+        }
+        world.board_count = i;
+    }
+
+    PosixIOStream stream(options.output_name, true);
+    SerializerFormatZZT serializer(options.format);
+    if (stream.errored() || !serializer.serialize_world(world, stream, [](int i){})) {
+        fprintf(stderr, "[worldgen] could not write %s\n", options.output_name);
+        return 1;
+    }
+
+    delete game;
+    return 0;
+}